@@ -13,11 +13,12 @@
 #include <sstream>
 #include <typeinfo>
 #include <cmath>
+#include <fstream>
 
 /// User includes:
 //// Basic includes:
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/EDAnalyzer.h"
+#include "FWCore/Framework/interface/one/EDAnalyzer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/FileBlock.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
@@ -91,7 +92,12 @@ using namespace edm;
 // \STRUCTURES
 
 // CLASS DEFINITIONS:
-class JetTuplizer : public edm::EDAnalyzer {
+// The tuplizer fills TFileService trees, so it's a "one" module that shares the
+// TFileService resource: it sees one event at a time, while the rest of the
+// path (the JetWorkshop producers and the JetFilter) runs concurrently. It also
+// watches the input files, so each event can be traced back to its MiniAOD file
+// (see "study_event_displays/event_index.cc").
+class JetTuplizer : public edm::one::EDAnalyzer<edm::one::SharedResources, edm::one::WatchRuns, edm::one::WatchLuminosityBlocks, edm::one::WatchInputFiles> {
 	public:
 		explicit JetTuplizer(const edm::ParameterSet&);		// Set the class argument to be (a reference to) a parameter set (?)
 		~JetTuplizer();		// Create the destructor.
@@ -121,11 +127,12 @@ class JetTuplizer : public edm::EDAnalyzer {
 		virtual void find_btagsf(BTagCalibrationReader);
 		virtual void analyze(const edm::Event&, const edm::EventSetup&);
 		virtual void endJob();
-		virtual void beginRun(const edm::Run&, const edm::EventSetup&);
-		virtual void endRun(const edm::Run&, const edm::EventSetup&);
-		virtual void beginLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup&);
-		virtual void endLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup&);
-		virtual void respondToOpenInputFile(const edm::FileBlock&);
+		virtual void beginRun(const edm::Run&, const edm::EventSetup&) override;
+		virtual void endRun(const edm::Run&, const edm::EventSetup&) override;
+		virtual void beginLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup&) override;
+		virtual void endLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup&) override;
+		virtual void respondToOpenInputFile(const edm::FileBlock&) override;
+		virtual void respondToCloseInputFile(const edm::FileBlock&) override;
 
 	// Member data
 	/// Configuration variables (filled by setting the python configuration file)
@@ -137,6 +144,7 @@ class JetTuplizer : public edm::EDAnalyzer {
 	string pileup_path_;
 	string jec_version_mc_;
 	string jec_version_data_;
+	string pum_;                // Pileup mitigation of the JetWorkshop collections ("chs", "sk", ...)
 	// Basic fatjet variables
 	// Algorithm variables
 	int n_event, n_event_sel, n_sel_lead, counter, n_error_g, n_error_q, n_error_sq, n_error_sq_match, n_error_m, n_error_sort;
@@ -151,6 +159,8 @@ class JetTuplizer : public edm::EDAnalyzer {
 	
 	// JEC info:
 	string jec_prefix;
+	string pum_title;           // "CHS", "SK", ... (as in the JetWorkshop module labels)
+	string jec_payload_ak4, jec_payload_ak8;   // "AK4PFchs", "AK8PFsk", ...
 	vector<string> jec_ak4_files, jmc_ak4_files, jec_ak8_files, jmc_ak8_files;
 	FactorizedJetCorrector *jec_corrector_ak4, *jmc_corrector_ak4, *jec_corrector_ak8, *jmc_corrector_ak8;
 	
@@ -169,6 +179,10 @@ class JetTuplizer : public edm::EDAnalyzer {
 	map<string, map<string, TBranch*>> tbranches;
 	TTree* tt;
 	
+	// Input file info (the "files" tree):
+	string input_file;          // The LFN of the MiniAOD file being read
+	double input_file_id;       // A hash of "input_file"
+	
 	// Event variables:
 	double pt_hat;
 	double rho;
@@ -233,6 +247,7 @@ JetTuplizer::JetTuplizer(const edm::ParameterSet& iConfig) :
 	pileup_path_(iConfig.getParameter<string>("pileup_path")),
 	jec_version_mc_(iConfig.getParameter<string>("jec_version_mc")),
 	jec_version_data_(iConfig.getParameter<string>("jec_version_data")),
+	pum_(iConfig.getParameter<string>("pum")),
 	// Consume statements:
 	genInfo_(consumes<GenEventInfoProduct>(iConfig.getParameter<InputTag>("genInfo"))),
 	rhoInfo_(consumes<double>(iConfig.getParameter<InputTag>("rhoInfo"))),
@@ -401,6 +416,7 @@ JetTuplizer::JetTuplizer(const edm::ParameterSet& iConfig) :
 		"event",
 		"lumi",
 		"run",
+		"file_id",    // The "file_id" of the MiniAOD file that the event is in (see the "files" tree)
 		"wpu",        // Pile-up re-weighting factor
 		"trig_pfht800",
 		"trig_pfht900",
@@ -417,11 +433,18 @@ JetTuplizer::JetTuplizer(const edm::ParameterSet& iConfig) :
 	};
 	
 	// Ntuple setup:
+	usesResource("TFileService");
 	edm::Service<TFileService> fs;		// Open output services
 	
 	/// Event-by-event variables:
 	ttrees["events"] = fs->make<TTree>();
 	ttrees["events"]->SetName("events");
+	/// Input files, one entry per MiniAOD file that was opened:
+	ttrees["files"] = fs->make<TTree>();
+	ttrees["files"]->SetName("files");
+	ttrees["files"]->Branch("file_id", &input_file_id, "file_id/D");
+	ttrees["files"]->Branch("file", &input_file);
+	input_file_id = -1;
 	
 	//// Build jet branches:
 	///// miniAOD jet branches:
@@ -507,12 +530,25 @@ JetTuplizer::JetTuplizer(const edm::ParameterSet& iConfig) :
 	// JEC setup:
 	jec_prefix = jec_version_mc_;
 	if (is_data_) jec_prefix = jec_version_data_;
+	pum_title = boost::to_upper_copy<string>(pum_);
+	
+	/// Use the JEC payload for the pileup mitigation if there is one, otherwise fall back to CHS:
+	jec_payload_ak4 = "AK4PF" + pum_;
+	jec_payload_ak8 = "AK8PF" + pum_;
+	if (!ifstream(jec_prefix + "_L1FastJet_" + jec_payload_ak4 + ".txt").good()) {
+		cout << "WARNING (JetTuplizer): There are no " << jec_payload_ak4 << " JECs, so the AK4PFchs ones will be used." << endl;
+		jec_payload_ak4 = "AK4PFchs";
+	}
+	if (!ifstream(jec_prefix + "_L1FastJet_" + jec_payload_ak8 + ".txt").good()) {
+		cout << "WARNING (JetTuplizer): There are no " << jec_payload_ak8 << " JECs, so the AK8PFchs ones will be used." << endl;
+		jec_payload_ak8 = "AK8PFchs";
+	}
 	
 	/// AK4 JEC setup:
-	jec_ak4_files.push_back(jec_prefix + "_L1FastJet_AK4PFchs.txt");
-	jec_ak4_files.push_back(jec_prefix + "_L2Relative_AK4PFchs.txt");
-	jec_ak4_files.push_back(jec_prefix + "_L3Absolute_AK4PFchs.txt");
-	if (is_data_) jec_ak4_files.push_back(jec_prefix + "_L2L3Residual_AK4PFchs.txt");
+	jec_ak4_files.push_back(jec_prefix + "_L1FastJet_" + jec_payload_ak4 + ".txt");
+	jec_ak4_files.push_back(jec_prefix + "_L2Relative_" + jec_payload_ak4 + ".txt");
+	jec_ak4_files.push_back(jec_prefix + "_L3Absolute_" + jec_payload_ak4 + ".txt");
+	if (is_data_) jec_ak4_files.push_back(jec_prefix + "_L2L3Residual_" + jec_payload_ak4 + ".txt");
 	vector<JetCorrectorParameters> jec_parameters_ak4;
 	for (vector<string>::const_iterator jec_file = jec_ak4_files.begin(); jec_file != jec_ak4_files.end(); ++jec_file) {
 //		cout << *jec_file << endl;
@@ -521,9 +557,9 @@ JetTuplizer::JetTuplizer(const edm::ParameterSet& iConfig) :
 	jec_corrector_ak4 = new FactorizedJetCorrector(jec_parameters_ak4);
 	
 	/// AK4 JMC setup:
-	jmc_ak4_files.push_back(jec_prefix + "_L2Relative_AK4PFchs.txt");
-	jmc_ak4_files.push_back(jec_prefix + "_L3Absolute_AK4PFchs.txt");
-	if (is_data_) jmc_ak4_files.push_back(jec_prefix + "_L2L3Residual_AK4PFchs.txt");
+	jmc_ak4_files.push_back(jec_prefix + "_L2Relative_" + jec_payload_ak4 + ".txt");
+	jmc_ak4_files.push_back(jec_prefix + "_L3Absolute_" + jec_payload_ak4 + ".txt");
+	if (is_data_) jmc_ak4_files.push_back(jec_prefix + "_L2L3Residual_" + jec_payload_ak4 + ".txt");
 	vector<JetCorrectorParameters> jmc_parameters_ak4;
 	for (vector<string>::const_iterator jmc_file = jmc_ak4_files.begin(); jmc_file != jmc_ak4_files.end(); ++jmc_file) {
 //		cout << *jmc_file << endl;
@@ -532,10 +568,10 @@ JetTuplizer::JetTuplizer(const edm::ParameterSet& iConfig) :
 	jmc_corrector_ak4 = new FactorizedJetCorrector(jmc_parameters_ak4);
 
 	/// AK8 JEC setup:
-	jec_ak8_files.push_back(jec_prefix + "_L1FastJet_AK8PFchs.txt");
-	jec_ak8_files.push_back(jec_prefix + "_L2Relative_AK8PFchs.txt");
-	jec_ak8_files.push_back(jec_prefix + "_L3Absolute_AK8PFchs.txt");
-	if (is_data_) jec_ak8_files.push_back(jec_prefix + "_L2L3Residual_AK8PFchs.txt");
+	jec_ak8_files.push_back(jec_prefix + "_L1FastJet_" + jec_payload_ak8 + ".txt");
+	jec_ak8_files.push_back(jec_prefix + "_L2Relative_" + jec_payload_ak8 + ".txt");
+	jec_ak8_files.push_back(jec_prefix + "_L3Absolute_" + jec_payload_ak8 + ".txt");
+	if (is_data_) jec_ak8_files.push_back(jec_prefix + "_L2L3Residual_" + jec_payload_ak8 + ".txt");
 	vector<JetCorrectorParameters> jec_parameters_ak8;
 	for (vector<string>::const_iterator jec_file = jec_ak8_files.begin(); jec_file != jec_ak8_files.end(); ++jec_file) {
 //		cout << *jec_file << endl;
@@ -544,9 +580,9 @@ JetTuplizer::JetTuplizer(const edm::ParameterSet& iConfig) :
 	jec_corrector_ak8 = new FactorizedJetCorrector(jec_parameters_ak8);
 	
 	/// AK8 JMC setup:
-	jmc_ak8_files.push_back(jec_prefix + "_L2Relative_AK8PFchs.txt");
-	jmc_ak8_files.push_back(jec_prefix + "_L3Absolute_AK8PFchs.txt");
-	if (is_data_) jmc_ak8_files.push_back(jec_prefix + "_L2L3Residual_AK8PFchs.txt");
+	jmc_ak8_files.push_back(jec_prefix + "_L2Relative_" + jec_payload_ak8 + ".txt");
+	jmc_ak8_files.push_back(jec_prefix + "_L3Absolute_" + jec_payload_ak8 + ".txt");
+	if (is_data_) jmc_ak8_files.push_back(jec_prefix + "_L2L3Residual_" + jec_payload_ak8 + ".txt");
 	vector<JetCorrectorParameters> jmc_parameters_ak8;
 	for (vector<string>::const_iterator jmc_file = jmc_ak8_files.begin(); jmc_file != jmc_ak8_files.end(); ++jmc_file) {
 //		cout << *jmc_file << endl;
@@ -567,6 +603,7 @@ JetTuplizer::JetTuplizer(const edm::ParameterSet& iConfig) :
 	cout << "in_type = " << in_type_ << endl;
 	cout << "v = " << v_ << endl;
 	cout << "jec_prefix = " << jec_prefix << endl;
+	cout << "jec_payloads = " << jec_payload_ak4 << ", " << jec_payload_ak8 << endl;
 	cout << "is_data = " << is_data_ << endl;
 }
 
@@ -702,28 +739,43 @@ void JetTuplizer::process_jets_pf(const edm::Event& iEvent,
 
 		// Define basic event variables:
 		double m = jet->mass();
-		string mass_tag = string("mass") + boost::to_upper_copy<string>(algo) + string("CHS");
+		string mass_tag = string("mass") + boost::to_upper_copy<string>(algo) + pum_title;
 		double mf = jet->userFloat(mass_tag + string("Filtered"));
 		double mp = jet->userFloat(mass_tag + string("Pruned"));
 		double ms = jet->userFloat(mass_tag + string("SoftDrop"));
 		double mt = jet->userFloat(mass_tag + string("Trimmed"));
-		string tau_tag = string("taus") + boost::to_upper_copy<string>(algo) + string("CHS") + string(":tau");
+		string tau_tag = string("taus") + boost::to_upper_copy<string>(algo) + pum_title + string(":tau");
 		double tau1 = jet->userFloat(tau_tag + string("1"));
 		double tau2 = jet->userFloat(tau_tag + string("2"));
 		double tau3 = jet->userFloat(tau_tag + string("3"));
 		double tau4 = jet->userFloat(tau_tag + string("4"));
 		double tau5 = jet->userFloat(tau_tag + string("5"));
 		double tau21 = 100, tau31 = 100, tau32 = 100, tau41 = 100, tau42 = 100, tau43 = 100, tau51 = 100, tau52 = 100, tau53 = 100, tau54 = 100;
-		if (tau1 > 0) tau21 = tau2/tau1;
-		if (tau1 > 0) tau31 = tau3/tau1;
-		if (tau2 > 0) tau32 = tau3/tau2;
-		if (tau1 > 0) tau41 = tau4/tau1;
-		if (tau2 > 0) tau42 = tau4/tau2;
-		if (tau3 > 0) tau43 = tau4/tau3;
-		if (tau1 > 0) tau51 = tau5/tau1;
-		if (tau2 > 0) tau52 = tau5/tau2;
-		if (tau3 > 0) tau53 = tau5/tau3;
-		if (tau4 > 0) tau54 = tau5/tau4;
+		if (jet->hasUserFloat(tau_tag + string("21"))) {
+			// The NsubjettinessProducer also makes the ratios (100 if the denominator is 0):
+			tau21 = jet->userFloat(tau_tag + string("21"));
+			tau31 = jet->userFloat(tau_tag + string("31"));
+			tau32 = jet->userFloat(tau_tag + string("32"));
+			tau41 = jet->userFloat(tau_tag + string("41"));
+			tau42 = jet->userFloat(tau_tag + string("42"));
+			tau43 = jet->userFloat(tau_tag + string("43"));
+			tau51 = jet->userFloat(tau_tag + string("51"));
+			tau52 = jet->userFloat(tau_tag + string("52"));
+			tau53 = jet->userFloat(tau_tag + string("53"));
+			tau54 = jet->userFloat(tau_tag + string("54"));
+		}
+		else {
+			if (tau1 > 0) tau21 = tau2/tau1;
+			if (tau1 > 0) tau31 = tau3/tau1;
+			if (tau2 > 0) tau32 = tau3/tau2;
+			if (tau1 > 0) tau41 = tau4/tau1;
+			if (tau2 > 0) tau42 = tau4/tau2;
+			if (tau3 > 0) tau43 = tau4/tau3;
+			if (tau1 > 0) tau51 = tau5/tau1;
+			if (tau2 > 0) tau52 = tau5/tau2;
+			if (tau3 > 0) tau53 = tau5/tau3;
+			if (tau4 > 0) tau54 = tau5/tau4;
+		}
 		double px = jet->px();
 		double py = jet->py();
 		double pz = jet->pz();
@@ -839,7 +891,7 @@ void JetTuplizer::process_jets_pf(const edm::Event& iEvent,
 		double spx2 = 0, spy2 = 0, spz2 = 0, se2 = 0, spt2 = 0, sm2 = 0, seta2 = 0, sphi2 = 0;
 		double spx3 = 0, spy3 = 0, spz3 = 0, se3 = 0, spt3 = 0, sm3 = 0, seta3 = 0, sphi3 = 0;
 		if (algo == "ca12") {		// Only get subjet variables for ungroomed CA12 jets.
-			string subjet_tag = string("subjets") + boost::to_upper_copy<string>(algo) + string("CHS:");
+			string subjet_tag = string("subjets") + boost::to_upper_copy<string>(algo) + pum_title + string(":");
 			spx0 = jet->userFloat(subjet_tag + string("px0"));
 			spx1 = jet->userFloat(subjet_tag + string("px1"));
 			spx2 = jet->userFloat(subjet_tag + string("px2"));
@@ -883,7 +935,7 @@ void JetTuplizer::process_jets_pf(const edm::Event& iEvent,
 		double tau1t = -1, tau2t = -1, tau3t = -1, tau4t = -1, tau5t = -1;
 		if (njet < 5) {		// Only save for the first four saved jets.
 			double epsilon = 0.000001;
-			string taug_tag = string("taus") + boost::to_upper_copy<string>(algo) + string("CHSFiltered") + string(":tau");
+			string taug_tag = string("taus") + boost::to_upper_copy<string>(algo) + pum_title + string("Filtered") + string(":tau");
 			for (vector<pat::Jet>::const_iterator jetg = jets_f->begin(); jetg != jets_f->end(); ++ jetg) {
 				double mg = jetg->mass();
 //				cout << njet << "   " << mf/jmc << "   " << mg << endl;
@@ -896,7 +948,7 @@ void JetTuplizer::process_jets_pf(const edm::Event& iEvent,
 					break;
 				}
 			}
-			taug_tag = string("taus") + boost::to_upper_copy<string>(algo) + string("CHSPruned") + string(":tau");
+			taug_tag = string("taus") + boost::to_upper_copy<string>(algo) + pum_title + string("Pruned") + string(":tau");
 			for (vector<pat::Jet>::const_iterator jetg = jets_p->begin(); jetg != jets_p->end(); ++ jetg) {
 				double mg = jetg->mass();
 				if (fabs(mg - mp/jmc) <= epsilon*fabs(mg)) {
@@ -908,7 +960,7 @@ void JetTuplizer::process_jets_pf(const edm::Event& iEvent,
 					break;
 				}
 			}
-			taug_tag = string("taus") + boost::to_upper_copy<string>(algo) + string("CHSSoftDrop") + string(":tau");
+			taug_tag = string("taus") + boost::to_upper_copy<string>(algo) + pum_title + string("SoftDrop") + string(":tau");
 			for (vector<pat::Jet>::const_iterator jetg = jets_s->begin(); jetg != jets_s->end(); ++ jetg) {
 				double mg = jetg->mass();
 				if (fabs(mg - ms/jmc) <= epsilon*fabs(mg)) {
@@ -920,7 +972,7 @@ void JetTuplizer::process_jets_pf(const edm::Event& iEvent,
 					break;
 				}
 			}
-			taug_tag = string("taus") + boost::to_upper_copy<string>(algo) + string("CHSTrimmed") + string(":tau");
+			taug_tag = string("taus") + boost::to_upper_copy<string>(algo) + pum_title + string("Trimmed") + string(":tau");
 			for (vector<pat::Jet>::const_iterator jetg = jets_t->begin(); jetg != jets_t->end(); ++ jetg) {
 				double mg = jetg->mass();
 				if (fabs(mg - mt/jmc) <= epsilon*fabs(mg)) {
@@ -1550,6 +1602,7 @@ void JetTuplizer::analyze(
 		branches["event"]["event"].push_back(iEvent.id().event());
 		branches["event"]["lumi"].push_back(iEvent.id().luminosityBlock());
 		branches["event"]["run"].push_back(iEvent.id().run());
+		branches["event"]["file_id"].push_back(input_file_id);
 		branches["event"]["npv"].push_back(npv);
 		
 		/// JER setup:
@@ -1615,11 +1668,26 @@ JetTuplizer::endLuminosityBlock(edm::LuminosityBlock const&, edm::EventSetup con
 {
 }
 
-void
+// ------------ method called when opening an input file  ------------
+// The file is identified by a hash of its name rather than by the order it was
+// opened in, so the IDs stay unique when the tuples of many jobs are combined.
+void 
 JetTuplizer::respondToOpenInputFile(edm::FileBlock const& fb)
 {
-//	cout << "NEW FILE" << endl;
-//	cout << fb.fileName() << endl;
+	input_file = fb.fileName();
+	unsigned long long hash = 14695981039346656037ULL;		// 64-bit FNV-1a
+	for (unsigned char c : input_file) {
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+	input_file_id = (double) (hash >> 12);		// (52 bits, so it's exact as a double.)
+	ttrees["files"]->Fill();
+}
+
+// ------------ method called when closing an input file  ------------
+void 
+JetTuplizer::respondToCloseInputFile(edm::FileBlock const&)
+{
 }
 
 // ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
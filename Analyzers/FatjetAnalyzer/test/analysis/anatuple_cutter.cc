@@ -0,0 +1,206 @@
+// Single-pass anatuple cutter. It reads each tree of an anatuple once and
+// writes every entry that passes each requested cut from "cuts.yaml" to that
+// cut's file ("anatuple_<cut>.root"), the same files that one "CopyTree" per
+// cut used to make.
+//
+// Cuts are nested automatically: if every "&&" term of cut A is also a term of
+// cut B (like "pre" and "sigxtau4"), B is only evaluated on the entries that
+// pass A, and only on its extra terms. That's only done when every term of B
+// is a scalar in the tree being cut: CopyTree ANDs array terms instance by
+// instance, which isn't the same as ANDing whether each term passes for any
+// instance, so a cut with an array term is evaluated whole, as one formula.
+// Only the branches that a cut needs are read to evaluate it; the whole entry
+// is read once, if any cut passes.
+//
+// Usage:
+//     root -l -b -q 'anatuple_cutter.cc+("anatuple.root", "pre,prehtjec,sigxtau4")'
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TIter.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TTreeFormula.h"
+#include "TStopwatch.h"
+
+using namespace std;
+
+map<TString, TString> read_cuts(TString path="cuts.yaml") {
+	// "cuts.yaml" is a flat list of "key: expression" lines:
+	map<TString, TString> cuts;
+	ifstream f_in(path.Data());
+	string line_raw;
+	while (getline(f_in, line_raw)) {
+		TString line = line_raw;
+		line = line.Strip(TString::kBoth);
+		if (line.BeginsWith("#") || !line.Contains(":")) continue;
+		TString key = line(0, line.First(':'));
+		TString value = line(line.First(':') + 1, line.Length());
+		value = value.Strip(TString::kBoth);
+		value = value.Strip(TString::kBoth, '"');
+		value = value.Strip(TString::kBoth, '\'');
+		cuts[key.Strip(TString::kBoth)] = value;
+	}
+	return cuts;
+}
+
+vector<TString> split_terms(TString cut) {
+	// Split a cut into its top-level "&&" terms. A cut with a top-level "||" is one term ("a&&b||c" is "(a&&b)||c"):
+	vector<TString> terms;
+	int depth = 0, start = 0;
+	for (int i = 0; i < cut.Length(); ++i) {
+		if (cut[i] == '(') depth++;
+		else if (cut[i] == ')') depth--;
+		else if (depth == 0 && cut[i] == '|' && i + 1 < cut.Length() && cut[i + 1] == '|') return {cut.Strip(TString::kBoth)};
+		else if (depth == 0 && cut[i] == '&' && i + 1 < cut.Length() && cut[i + 1] == '&') {
+			terms.push_back(TString(cut(start, i - start)).Strip(TString::kBoth));
+			start = i + 2;
+			i++;
+		}
+	}
+	terms.push_back(TString(cut(start, cut.Length() - start)).Strip(TString::kBoth));
+	return terms;
+}
+
+struct cut_node {
+	TString key;
+	vector<TString> terms;
+	bool scalar;                // Every term is a scalar in the current tree (so the cut can be nested)
+	int parent;                 // Index of the cut whose terms are a subset of this one (-1: none)
+	TString remainder;          // The terms that the parent doesn't already apply
+	TTreeFormula* formula;
+	TFile* tf_out;
+	TTree* tt_out;
+	bool pass;
+	Long64_t n_pass;
+};
+
+bool pass_formula(TTreeFormula* formula) {
+	// An entry passes if any instance passes (the same as "CopyTree"):
+	if (!formula) return true;
+	int ndata = formula->GetNdata();
+	for (int i = 0; i < ndata; ++i) {
+		if (formula->EvalInstance(i) != 0) return true;
+	}
+	return false;
+}
+
+void nest_cuts(vector<cut_node>& nodes, TTree* tt) {
+	// Find each cut's parent and the terms that it adds, for the tree "tt":
+	for (auto& node : nodes) {
+		node.scalar = true;
+		for (auto& term : node.terms) {
+			TTreeFormula formula("term", term, tt);
+			if (formula.GetMultiplicity() != 0) node.scalar = false;
+		}
+	}
+	for (unsigned i = 0; i < nodes.size(); ++i) {
+		nodes[i].parent = -1;
+		nodes[i].remainder = "";
+		if (!nodes[i].scalar) {
+			// Evaluate the whole cut as one formula, like CopyTree:
+			for (auto& term : nodes[i].terms) nodes[i].remainder += (nodes[i].remainder.Length() ? "&&" : "") + term;
+			cout << "\t" << nodes[i].key << " (array terms, not nested): " << nodes[i].remainder << endl;
+			continue;
+		}
+		unsigned n_shared = 0;
+		for (unsigned j = 0; j < i; ++j) {
+			if (!nodes[j].scalar) continue;
+			bool subset = true;
+			for (auto& term : nodes[j].terms) {
+				if (find(nodes[i].terms.begin(), nodes[i].terms.end(), term) == nodes[i].terms.end()) subset = false;
+			}
+			if (subset && nodes[j].terms.size() > n_shared) {
+				nodes[i].parent = j;
+				n_shared = nodes[j].terms.size();
+			}
+		}
+		for (auto& term : nodes[i].terms) {
+			if (nodes[i].parent >= 0) {
+				const vector<TString>& parent_terms = nodes[nodes[i].parent].terms;
+				if (find(parent_terms.begin(), parent_terms.end(), term) != parent_terms.end()) continue;
+			}
+			nodes[i].remainder += (nodes[i].remainder.Length() ? "&&" : "") + term;
+		}
+		cout << "\t" << nodes[i].key << (nodes[i].parent >= 0 ? " (after " + nodes[nodes[i].parent].key + ")" : TString("")) << ": " << (nodes[i].remainder.Length() ? nodes[i].remainder : TString("1")) << endl;
+	}
+}
+
+void anatuple_cutter(TString f_in, TString cut_keys="pre", TString cuts_path="cuts.yaml") {
+	TStopwatch timer;
+	map<TString, TString> known_cuts = read_cuts(cuts_path);
+
+	// Read the cuts:
+	vector<cut_node> nodes;
+	TObjArray* keys = cut_keys.Tokenize(",");
+	for (int i = 0; i < keys->GetEntries(); ++i) {
+		TString key = ((TObjString*) keys->At(i))->GetString();
+		if (known_cuts.find(key) == known_cuts.end()) {
+			cout << "[!!] ERROR: " << key << " isn't in " << cuts_path << "." << endl;
+			return;
+		}
+		nodes.push_back({key, split_terms(known_cuts[key]), false, -1, "", 0, 0, 0, false, 0});
+	}
+	/// Parents come before their children (a parent has fewer terms):
+	stable_sort(nodes.begin(), nodes.end(), [](const cut_node& a, const cut_node& b) {return a.terms.size() < b.terms.size();});
+
+	// Open the input and outputs:
+	TFile* tf_in = TFile::Open(f_in);
+	if (!tf_in || tf_in->IsZombie()) {
+		cout << "[!!] ERROR: Can't open " << f_in << "." << endl;
+		return;
+	}
+	for (auto& node : nodes) node.tf_out = TFile::Open(TString(f_in).ReplaceAll(".root", "_" + node.key + ".root"), "RECREATE");
+
+	// Loop over the trees (merged files have a key for each cycle of a tree, so only the latest cycle of each is cut):
+	set<TString> done;
+	TIter next(tf_in->GetListOfKeys());
+	while (TKey* key = (TKey*) next()) {
+		if (TString(key->GetClassName()) != "TTree" || !done.insert(key->GetName()).second) continue;
+		TTree* tt_in = (TTree*) tf_in->Get(key->GetName());
+		cout << "[..] Cutting " << tt_in->GetName() << "." << endl;
+		nest_cuts(nodes, tt_in);
+		for (auto& node : nodes) {
+			node.tf_out->cd();
+			node.tt_out = tt_in->CloneTree(0);
+			node.formula = node.remainder.Length() ? new TTreeFormula(node.key, node.remainder, tt_in) : 0;
+			node.n_pass = 0;
+		}
+
+		Long64_t n = tt_in->GetEntries();
+		for (Long64_t i = 0; i < n; ++i) {
+			tt_in->LoadTree(i);		// The formulas read only the branches that they need.
+			bool any = false;
+			for (auto& node : nodes) {
+				node.pass = (node.parent < 0 || nodes[node.parent].pass) && pass_formula(node.formula);
+				any = any || node.pass;
+			}
+			if (!any) continue;
+			tt_in->GetEntry(i);
+			for (auto& node : nodes) {
+				if (!node.pass) continue;
+				node.tt_out->Fill();
+				node.n_pass++;
+			}
+		}
+
+		for (auto& node : nodes) {
+			cout << "\t" << node.key << ": " << node.n_pass << "/" << n << endl;
+			node.tf_out->WriteTObject(node.tt_out, tt_in->GetName(), "Overwrite");
+			delete node.formula;
+			node.tt_out->ResetBranchAddresses();
+		}
+	}
+	for (auto& node : nodes) node.tf_out->Close();
+	tf_in->Close();
+	cout << "[OK] Cut " << f_in << " in " << timer.RealTime() << " s." << endl;
+}
@@ -6,8 +6,7 @@
 
 # IMPORTS:
 import sys, yaml
-from truculence import root
-from ROOT import TFile, TCut
+from ROOT import gROOT
 #from plotter import get_cuts
 # :IMPORTS
 
@@ -20,28 +19,21 @@ from ROOT import TFile, TCut
 # FUNCTIONS:
 def main():
 	# Arguments:
+	## "python anatuple_cutter.py anatuple.root [cut1 cut2 ...]"
 	assert len(sys.argv) > 1
 	f_in = sys.argv[1]
 	with open("cuts.yaml") as f:
 		known_cuts = yaml.load(f)
-	cut_key = "pre"
-	if len(sys.argv) > 2:
-		if sys.argv[2] in known_cuts:
-			cut_key = sys.argv[2]
-	tcut = TCut(cut_key, known_cuts[cut_key])
-	cut = tcut.GetTitle()
-	print "[..] Applying the following cut to {}:\n{}\n".format(f_in, cut)
-	f_out = f_in.replace(".root", "_{}.root".format(cut_key))
+	cut_keys = [key for key in sys.argv[2:] if key in known_cuts]
+	if not cut_keys: cut_keys = ["pre"]
+	for key in cut_keys:
+		print "[..] Applying {} to {}:\n{}\n".format(key, f_in, known_cuts[key])
 	
-	# Apply the cut:
-	rf = root.rfile(f_in)
-	tts = rf.get_ttrees()
-	tf_out = TFile(f_out, "RECREATE")
-	for tt_name, tt in tts.items():
-		print "[..] Cutting {}.".format(tt.GetName())
-		tt_out = tt.CopyTree(cut)
-		tf_out.WriteTObject(tt_out)
-	tf_out.Close()
+	# Apply the cuts (every tree is read once, however many cuts there are):
+	gROOT.SetBatch()
+	gROOT.ProcessLine(".L anatuple_cutter.cc+")
+	from ROOT import anatuple_cutter
+	anatuple_cutter(f_in, ",".join(cut_keys), "cuts.yaml")
 	return True
 # :FUNCTIONS
 
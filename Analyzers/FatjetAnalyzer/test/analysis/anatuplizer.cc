@@ -0,0 +1,313 @@
+// Compiled anatuplizer engine. It makes the same anatuple trees as the event
+// loop in "anatuplizer.py" ("treat_event"), driven by the same "anatuple.yaml",
+// but it reads only the tuple branches that it needs and computes everything
+// in one compiled loop.
+//
+// From python (this is what "anatuplizer.py" does):
+//     gROOT.ProcessLine(".L anatuplizer.cc+")
+//     anatuplize(tchain, "qcdmg", "anatuple.root", "RECREATE")
+// A range of entries can be anatuplized on its own (with the "w" normalization
+// of the whole job) so that "anatuplizer.py" can split a job across processes.
+// Standalone:
+//     root -l -b -q 'anatuplizer.cc+("tuple_*.root", "qcdmg", "anatuple.root")'
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <functional>
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TChain.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TStopwatch.h"
+
+using namespace std;
+
+struct anatuple_variable {
+	TString name, type;
+	int dimension;
+};
+
+vector<anatuple_variable> read_anatuple_variables(TString path="anatuple.yaml") {
+	// "anatuple.yaml" is a list of flat entries ("- name: ...", "dimension: ...", "type: ...", "description: ..."), so it's read line by line.
+	vector<anatuple_variable> variables;
+	ifstream f_in(path.Data());
+	if (!f_in) {
+		cout << "[!!] ERROR: Can't open " << path << "." << endl;
+		return variables;
+	}
+	string line_raw;
+	while (getline(f_in, line_raw)) {
+		TString line = line_raw;
+		line = line.Strip(TString::kBoth);
+		if (line.BeginsWith("#") || !line.Contains(":")) continue;
+		if (line.BeginsWith("- ")) {
+			variables.push_back({"", "", 1});
+			line.Remove(0, 2);
+		}
+		if (variables.empty()) continue;
+		TString key = line(0, line.First(':'));
+		TString value = line(line.First(':') + 1, line.Length());
+		value = value.Strip(TString::kBoth);
+		if (key == "name") variables.back().name = value;
+		else if (key == "type") variables.back().type = value;
+		else if (key == "dimension") variables.back().dimension = value.Atoi();
+	}
+	return variables;
+}
+
+
+class anatuplizer_engine {
+	public:
+		anatuplizer_engine(TTree* tt_in, TString alg, vector<anatuple_variable> variables) : tt(tt_in), alg_(alg), variables_(variables) {}
+
+		Long64_t run(TTree* tt_out, Long64_t n=-1, Long64_t first=0, double w_factor=-1) {
+			Long64_t n_tc = tt->GetEntries();
+			if (first < 0) first = 0;
+			if (n < 0 || first + n > n_tc) n = n_tc - first;
+			if (n <= 0) return 0;
+			weight_factor = double(n_tc)/n;		// "w" is normalized to the number of events that are anatuplized.
+			if (w_factor > 0) weight_factor = w_factor;		// (Unless the caller is running part of a bigger job.)
+
+			// Only read the branches that are used:
+			tt->SetBranchStatus("*", 0);
+			for (auto& variable : variables_) setup(variable);
+			for (auto& variable : variables_) {
+				outputs[variable.name].assign(max(1, variable.dimension), -1);
+				TString leaves = variable.name + (variable.dimension > 1 ? TString::Format("[%d]", variable.dimension) : TString("")) + "/D";
+				tt_out->Branch(variable.name, &(outputs[variable.name][0]), leaves);
+			}
+
+			// Event loop:
+			for (Long64_t i = first; i < first + n; ++i) {
+				if (tt->GetEntry(i) <= 0) continue;
+				for (auto& output : outputs) fill(output.second.begin(), output.second.end(), -1);
+				calculate();
+				for (auto& filler : fillers) filler();
+				double& W = out("W");
+				W = out("w");
+				if (out("wpu") > 0) W *= out("wpu");
+				tt_out->Fill();
+			}
+			tt->SetBranchStatus("*", 1);
+			return n;
+		}
+
+	private:
+		TTree* tt;
+		TString alg_;
+		vector<anatuple_variable> variables_;
+		double weight_factor;
+		map<TString, vector<double>*> inputs;         // Tuple branches (every tuple branch is a vector<double>)
+		map<TString, vector<double>> outputs;         // Anatuple branches
+		map<TString, vector<double>> calc;            // Jet-pair variables computed each event
+		vector<function<void()>> fillers;             // One per output variable, built once
+		const vector<TString> groomers = {"", "f", "p", "s", "t"};
+
+		double& out(TString name) {
+			static double dummy;
+			auto it = outputs.find(name);
+			if (it == outputs.end()) return dummy;
+			return it->second[0];
+		}
+
+		vector<double>*& in(TString branch) {
+			// Register (and activate) a tuple branch:
+			auto it = inputs.find(branch);
+			if (it != inputs.end()) return it->second;
+			inputs[branch] = 0;
+			if (tt->GetBranch(branch)) {
+				tt->SetBranchStatus(branch, 1);
+				tt->SetBranchAddress(branch, &inputs[branch]);
+			}
+			return inputs[branch];
+		}
+
+		static double at(const vector<double>* v, unsigned i, double fallback=-1) {
+			return (v && i < v->size()) ? (*v)[i] : fallback;
+		}
+
+		TString jet_branch(TString variable) {return alg_ + "_pf_" + variable;}
+
+		void setup(const anatuple_variable& variable) {
+			TString name = variable.name;
+			int dim = variable.dimension;
+			if (variable.type == "lepton") return;		// Lepton variables aren't filled yet (the same as in "anatuplizer.py").
+			if (name == "W") return;		// Computed after the other variables
+
+			if (name == "w") {
+				vector<double>*& w = in("w");
+				fillers.push_back([this, &w]() {out("w") = at(w, 0)*weight_factor;});
+			}
+			else if (name == "njets") {
+				vector<double>*& v = in("ak4_pf_njets");
+				fillers.push_back([this, &v]() {out("njets") = at(v, 0);});
+			}
+			else if (name == "htak4") {
+				vector<double>*& v = in("ak4_pf_ht");
+				fillers.push_back([this, &v]() {out("htak4") = at(v, 0);});
+			}
+			else if (name == "htak8jec") {
+				vector<double>*& v = in("ak8_pf_ht");
+				fillers.push_back([this, &v]() {out("htak8jec") = at(v, 0);});
+			}
+			else if (name == "htak8") {
+				// HT from uncorrected AK8 jets with pT > 150 GeV and abs(eta) < 2.5:
+				vector<double>*& pt = in("ak8_pf_pt");
+				vector<double>*& jec = in("ak8_pf_jec");
+				vector<double>*& eta = in("ak8_pf_eta");
+				fillers.push_back([this, &pt, &jec, &eta]() {
+					double ht = 0;
+					if (pt && jec && eta) {
+						for (unsigned i = 0; i < pt->size() && i < jec->size() && i < eta->size(); ++i) {
+							double pt_raw = (*pt)[i]/(*jec)[i];
+							if (pt_raw > 150 && fabs((*eta)[i]) < 2.5) ht += pt_raw;
+						}
+					}
+					out("htak8") = ht;
+				});
+			}
+			else if (name == "wtt") {
+				vector<double>*& sf = in("q_gn_sf");
+				fillers.push_back([this, &sf]() {out("wtt") = (sf && sf->size() == 2) ? sqrt((*sf)[0]*(*sf)[1]) : 1;});
+			}
+			else if (name == "bd" || name == "jetid") {
+				vector<double>*& v = in(jet_branch(name == "bd" ? "bd_csv" : "jetid_l"));
+				vector<double>& o = outputs[name];
+				fillers.push_back([&v, &o, dim]() {for (int i = 0; i < dim; ++i) o[i] = at(v, i);});
+			}
+			else if (is_calculated(name)) {
+				vector<double>& o = outputs[name];
+				vector<double>& c = calc[name];
+				fillers.push_back([&c, &o, dim]() {for (int i = 0; i < dim && i < (int) c.size(); ++i) o[i] = c[i];});
+			}
+			else if (variable.type == "event") {
+				// Copy the tuple branch with the same name (some, like triggers, can be empty):
+				vector<double>*& v = in(name);
+				vector<double>& o = outputs[name];
+				fillers.push_back([&v, &o, dim]() {for (int i = 0; i < dim; ++i) o[i] = at(v, i);});
+			}
+			// Other jet variables are left at -1 (the same as in "anatuplizer.py").
+		}
+
+		// Jet-pair variables (the "vars_calc" of "anatuplizer.py"):
+		vector<TString> fetched_names() {
+			vector<TString> names = {"px", "py", "pz", "e", "pt", "eta", "phi", "jec", "jmc"};
+			for (auto& groomer : groomers) {
+				TString suffix = groomer == "" ? "" : "_" + groomer;
+				names.push_back("m" + suffix);
+				for (int n = 1; n <= 5; ++n) names.push_back(TString::Format("tau%d", n) + suffix);
+			}
+			for (int n = 2; n <= 5; ++n) {
+				for (int d = 1; d < n; ++d) names.push_back(TString::Format("tau%d%d", n, d));
+			}
+			return names;
+		}
+
+		TString tuple_name(TString name) {
+			// "m_p" -> "ca12_pf_mp", "tau21" -> "ca12_pf_tau21"
+			return jet_branch(TString(name).ReplaceAll("_", ""));
+		}
+
+		bool is_calculated(TString name) {
+			vector<TString> names = fetched_names();
+			for (TString pair : {"ptavg", "dpt", "ptasy", "deta", "dphi", "dr"}) names.push_back(pair);
+			for (auto& groomer : groomers) {
+				TString suffix = groomer == "" ? "" : "_" + groomer;
+				for (TString pair : {"mavg", "dm", "masy"}) names.push_back(pair + suffix);
+			}
+			for (auto& n : names) {
+				if (n == name) {
+					if (calc.find(name) == calc.end()) calc[name] = vector<double>();
+					if (fetched.empty()) {
+						for (auto& f : fetched_names()) fetched.push_back({f, &in(tuple_name(f))});
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+		vector<pair<TString, vector<double>**>> fetched;
+
+		void calculate() {
+			if (fetched.empty()) return;
+			for (auto& f : fetched) {
+				vector<double>& c = calc[f.first];
+				c.assign(2, -1);
+				vector<double>* v = *(f.second);
+				if (!v || v->size() < 2) continue;
+				c[0] = (*v)[0];
+				c[1] = (*v)[1];
+			}
+			const vector<double>& pt = calc["pt"];
+			const vector<double>& eta = calc["eta"];
+			const vector<double>& phi = calc["phi"];
+			double ptavg = (pt[0] + pt[1])/2;
+			double dpt = fabs(pt[0] - pt[1]);
+			double deta = fabs(eta[0] - eta[1]);
+			double dphi = M_PI - fabs(M_PI - fabs(phi[0] - phi[1]));
+			calc["ptavg"] = {ptavg};
+			calc["dpt"] = {dpt};
+			calc["ptasy"] = {ptavg != 0 ? dpt/ptavg/2 : -1};
+			calc["deta"] = {deta};
+			calc["dphi"] = {dphi};
+			calc["dr"] = {sqrt(deta*deta + dphi*dphi)};
+			for (auto& groomer : groomers) {
+				TString suffix = groomer == "" ? "" : "_" + groomer;
+				const vector<double>& m = calc["m" + suffix];
+				double mavg = (m[0] + m[1])/2;
+				double dm = fabs(m[0] - m[1]);
+				calc["mavg" + suffix] = {mavg};
+				calc["dm" + suffix] = {dm};
+				calc["masy" + suffix] = {mavg != 0 ? dm/mavg/2 : 2};
+			}
+		}
+};
+
+
+Long64_t anatuplize(TTree* tt_in, TString tree_name, TString out_path, TString option="RECREATE", TString alg="ca12", Long64_t n=-1, TString yaml="anatuple.yaml", Long64_t first=0, double w_factor=-1) {
+	// Anatuplize "n" entries of "tt_in" (a "tuplizer/events" tree or chain) starting at "first" into the tree "tree_name" of "out_path".
+	TStopwatch timer;
+	if (!tt_in || tt_in->GetEntries() <= 0) {
+		cout << "[!!] ERROR: There are no input events for " << tree_name << " (the tuple files might not open)." << endl;
+		return 0;
+	}
+	vector<anatuple_variable> variables = read_anatuple_variables(yaml);
+	if (variables.empty()) return 0;
+
+	TFile* tf_out = TFile::Open(out_path, option);
+	if (!tf_out || tf_out->IsZombie()) {
+		cout << "[!!] ERROR: Can't open " << out_path << "." << endl;
+		if (tf_out) delete tf_out;
+		return 0;
+	}
+	TTree* tt_out = new TTree(tree_name, "");
+	anatuplizer_engine engine(tt_in, alg, variables);
+	Long64_t n_run = engine.run(tt_out, n, first, w_factor);
+	tf_out->WriteTObject(tt_out, tree_name, "Overwrite");
+	tf_out->Close();
+
+	cout << "[OK] Anatuplized " << n_run << " events into " << tree_name << " (" << out_path << ") in " << timer.RealTime() << " s." << endl;
+	return n_run;
+}
+
+void anatuplizer(TString in_files, TString tree_name, TString out_path="anatuple.root", TString alg="ca12", Long64_t n=-1, TString yaml="anatuple.yaml") {
+	// Standalone entry point: "in_files" is a comma-separated list of tuple files (wildcards are allowed).
+	TChain* tc = new TChain("tuplizer/events");
+	TObjArray* files = in_files.Tokenize(",");
+	for (int i = 0; i < files->GetEntries(); ++i) {
+		// (With 0 entries, "Add" opens each file to count them, and returns 0 if none of them open.)
+		TString path = ((TObjString*) files->At(i))->GetString();
+		if (!tc->Add(path, 0)) {
+			cout << "[!!] ERROR: Can't open " << path << ", or it has no \"tuplizer/events\" tree." << endl;
+			return;
+		}
+	}
+	delete files;
+	anatuplize(tc, tree_name, out_path, "RECREATE", alg, n, yaml);
+}
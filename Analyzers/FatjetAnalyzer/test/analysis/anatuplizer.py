@@ -7,6 +7,8 @@
 # IMPORTS:
 print "Importing packages ..."
 import sys            # Allows "sys.exit()"
+import os
+import multiprocessing
 #import argparse       # For commandline options
 import random
 import numpy
@@ -24,6 +26,9 @@ from ROOT import *
 # /CLASSES
 
 # VARIABLES:
+engine = "cc"		# "cc": the compiled engine in "anatuplizer.cc"; "py": the "treat_event" loop below
+n_workers = 0		# Number of local processes for the compiled engine (0: one per core, 1: no splitting)
+chunk_min = 20000		# Don't split a process into pieces with fewer entries than this
 # /VARIABLES
 
 # FUNCTIONS:
@@ -34,6 +39,66 @@ def get_variables(f="anatuple.yaml"):
 		info = utilities.ordered_load(f_in)
 	return info["variables"]
 
+def get_files(tups):
+	# Tuple files from dataset entries (or plain paths):
+	files = []
+	for tup in tups:
+		if isinstance(tup, str): files.append(tup)
+		else: files.extend(["root://cmseos.fnal.gov/" + f if f.startswith("/store") else f for f in tup.files])
+	return files
+
+def run_task(task):
+	# Anatuplize one range of entries of one process into its own file (this runs in a worker process):
+	key, files, first, count, w_factor, alg, part_path = task
+	from ROOT import anatuplize
+	tc = root.make_tc(files, "tuplizer/events")
+	anatuplize(tc, key, part_path, "RECREATE", alg, count, "anatuple.yaml", first, w_factor)
+	return part_path
+
+def merge_parts(parts, out_path):
+	# Fast (basket-copying) merge of the partial anatuples; trees with the same name are concatenated in the order of "parts":
+	merger = TFileMerger(False, False)
+	merger.SetFastMethod(True)
+	merger.OutputFile(out_path, "RECREATE")
+	for part in parts: merger.AddFile(part, False)
+	good = merger.Merge()
+	if good:
+		for part in parts: os.remove(part)
+	return good
+
+def run_compiled(tuples, out_path, n=-1, alg="ca12", workers=n_workers):
+	# Anatuplize each process with the compiled engine, one tree per process in "out_path":
+	gROOT.ProcessLine(".L anatuplizer.cc+")		# Compile once, before any workers are forked.
+	if not alg: alg = "ca12"
+	if not n: n = -1
+	if workers <= 0: workers = multiprocessing.cpu_count()
+	
+	# Split each process into ranges of entries:
+	tasks = []
+	for key, tups in sorted(tuples.items()):
+		files = get_files(tups)
+		n_tc = root.make_tc(files, "tuplizer/events").GetEntries()
+		n_run = min(n, n_tc) if n > 0 else n_tc
+		if n_run <= 0: continue
+		w_factor = float(n_tc)/n_run		# "w" is renormalized by the entries of the whole process, not of each piece.
+		n_chunks = max(1, min(workers, n_run/chunk_min))
+		size = (n_run + n_chunks - 1)/n_chunks
+		for ichunk, first in enumerate(range(0, n_run, size)):
+			part_path = "{}.{}_{}.part".format(out_path, key, ichunk)
+			tasks.append((key, files, first, min(size, n_run - first), w_factor, alg, part_path))
+	print "[..] Anatuplizing {} processes in {} pieces with {} workers.".format(len(tuples), len(tasks), workers)
+	
+	# Run and merge:
+	if workers == 1: parts = [run_task(task) for task in tasks]
+	else:
+		pool = multiprocessing.Pool(workers)
+		parts = pool.map(run_task, tasks)		# Results come back in the order of "tasks", so the merge keeps the entry order.
+		pool.close()
+		pool.join()
+	if not merge_parts(parts, out_path):
+		print "[!!] ERROR: Merging the partial anatuples failed; they're still in {}.*.part".format(out_path)
+	return out_path
+
 def match_leptons(loop):
 	for ijet, jet_pt in enumerate(loop.branches["pt"]):
 		print ijet, jet_pt
@@ -198,6 +263,12 @@ def main():
 		out_file = args.output.split("/")[-1]
 		out_dir = "/".join(args.output.split("/")[:-1])
 	
+	if engine == "cc":
+		out_path = args.output
+		if not out_path: out_path = "anatuple_{}.root".format(args.condor) if args.condor else "anatuple.root"
+		print run_compiled(tuples, out_path, n=args.n, alg=args.algorithm, workers=1 if args.condor else n_workers)
+		return True
+	
 	ana = analyzer.analyzer(tuples, save=True, v=args.verbose, out_file=out_file, use_condor=args.condor)
 	vs_out = get_variables()
 	ana.define_branches(vs_out)
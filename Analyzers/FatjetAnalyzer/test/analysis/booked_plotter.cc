@@ -0,0 +1,186 @@
+// booked_plotter: fills many histograms of a tree in one event loop.
+//
+// Book every cut and every TH1/TH2 first, then call "fill" once per tree. Each
+// distinct expression is compiled into one TTreeFormula per tree, each cut is
+// evaluated once per entry, and a variable is only evaluated for entries that
+// pass at least one cut. The histograms are filled like "TTree::Draw" would
+// fill them: the cut is the weight ("w*(...)"), and array expressions fill one
+// entry per instance. Histogram names follow "plotter.py":
+//     TH1: "{tree}_{var}_{cut}"
+//     TH2: "{tree}_{var}_cut{cut}"
+// With "count_entries" set, "fill" also keeps the raw (unweighted) number of
+// entries in each bin, in "counts" (named like the histograms, plus "_n"), which
+// is what "garwood.cc" needs next to the sums of weights.
+//
+// From python:
+//     gROOT.ProcessLine(".L booked_plotter.cc+")
+//     plotter = booked_plotter()
+//     plotter.add_cut("sig", "w*(htak8>900&&masy_p<0.1)")
+//     plotter.book_th1("mavgp", "mavg_p", 1200, 0, 1200)
+//     for h in plotter.fill(tt): h.Write()
+
+#ifndef BOOKED_PLOTTER
+#define BOOKED_PLOTTER
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <initializer_list>
+#include "TString.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+#include "TH1.h"
+#include "TH1F.h"
+#include "TH2F.h"
+
+using namespace std;
+
+class booked_plotter {
+	public:
+		struct cut_booking {TString key, expression;};
+		struct hist_booking {
+			TString key;
+			vector<TString> expressions;      // {x} or {y, x} (the order of "TTree::Draw")
+			int nx, ny;
+			double xlo, xhi, ylo, yhi;
+		};
+
+		TString th2_cut_prefix = "cut";
+		bool count_entries = false;
+		vector<TH1*> counts;      // The raw entries of the last "fill" (in the same order as its histograms)
+
+		void add_cut(TString key, TString expression) {cuts.push_back({key, expression});}
+		void book_th1(TString key, TString expression, int n, double lo, double hi) {
+			hists.push_back({key, {expression}, n, 0, lo, hi, 0, 0});
+		}
+		void book_th2(TString key, TString expression_y, TString expression_x, int nx, double xlo, double xhi, int ny, double ylo, double yhi) {
+			hists.push_back({key, {expression_y, expression_x}, nx, ny, xlo, xhi, ylo, yhi});
+		}
+
+		vector<TH1*> fill(TTree* tt, Long64_t n=-1) {
+			// Fill every booked histogram for every booked cut from one loop over "tt":
+			TString tt_name = tt->GetName();
+			vector<TH1*> result;
+			vector<vector<TH1*>> h(cuts.size(), vector<TH1*>(hists.size(), 0));
+			vector<vector<TH1*>> h_n(cuts.size(), vector<TH1*>(hists.size(), 0));
+			counts.clear();
+			for (unsigned icut = 0; icut < cuts.size(); ++icut) {
+				for (unsigned ih = 0; ih < hists.size(); ++ih) {
+					const hist_booking& b = hists[ih];
+					TH1* hist;
+					if (b.expressions.size() == 1) hist = new TH1F(tt_name + "_" + b.key + "_" + cuts[icut].key, "", b.nx, b.xlo, b.xhi);
+					else hist = new TH2F(tt_name + "_" + b.key + "_" + th2_cut_prefix + cuts[icut].key, "", b.nx, b.xlo, b.xhi, b.ny, b.ylo, b.yhi);
+					hist->SetDirectory(0);
+					hist->Sumw2();
+					h[icut][ih] = hist;
+					result.push_back(hist);
+					if (count_entries) {
+						h_n[icut][ih] = (TH1*) hist->Clone(TString(hist->GetName()) + "_n");
+						h_n[icut][ih]->SetDirectory(0);
+						counts.push_back(h_n[icut][ih]);
+					}
+				}
+			}
+
+			// Compile each distinct expression once:
+			map<TString, TTreeFormula*> formulas;
+			map<TTreeFormula*, bool> scalar;        // (A length-1 array isn't a scalar: it doesn't broadcast.)
+			auto compile = [&](TString expression) {
+				if (formulas.find(expression) == formulas.end()) {
+					TTreeFormula* f = new TTreeFormula("f" + TString::Format("%d", (int) formulas.size()), expression, tt);
+					formulas[expression] = f;
+					scalar[f] = f->GetMultiplicity() == 0;
+				}
+				return formulas[expression];
+			};
+			vector<TTreeFormula*> f_cut;
+			for (auto& cut : cuts) f_cut.push_back(compile(cut.expression));
+			vector<vector<TTreeFormula*>> f_hist;
+			for (auto& b : hists) {
+				vector<TTreeFormula*> fs;
+				for (auto& expression : b.expressions) fs.push_back(compile(expression));
+				f_hist.push_back(fs);
+			}
+
+			// Event loop:
+			if (n < 0 || n > tt->GetEntries()) n = tt->GetEntries();
+			vector<vector<double>> weights(cuts.size());
+			map<TTreeFormula*, vector<double>> values;
+			for (Long64_t i = 0; i < n; ++i) {
+				tt->LoadTree(i);		// The formulas read only the branches that they need.
+				bool any = false;
+				for (unsigned icut = 0; icut < cuts.size(); ++icut) {
+					evaluate(f_cut[icut], weights[icut]);
+					for (auto w : weights[icut]) any = any || w != 0;
+				}
+				if (!any) continue;
+				values.clear();
+				for (unsigned ih = 0; ih < hists.size(); ++ih) {
+					for (auto f : f_hist[ih]) {
+						if (values.find(f) == values.end()) evaluate(f, values[f]);
+					}
+				}
+				for (unsigned icut = 0; icut < cuts.size(); ++icut) {
+					column w = {&weights[icut], scalar[f_cut[icut]]};
+					if (w.values->empty()) continue;
+					for (unsigned ih = 0; ih < hists.size(); ++ih) {
+						if (hists[ih].expressions.size() == 1) {
+							column x = {&values[f_hist[ih][0]], scalar[f_hist[ih][0]]};
+							unsigned ninst = instances({x, w});
+							for (unsigned k = 0; k < ninst; ++k) {
+								double wk = w.at(k);
+								if (wk == 0) continue;
+								h[icut][ih]->Fill(x.at(k), wk);
+								if (count_entries) h_n[icut][ih]->Fill(x.at(k));
+							}
+						}
+						else {
+							column y = {&values[f_hist[ih][0]], scalar[f_hist[ih][0]]};
+							column x = {&values[f_hist[ih][1]], scalar[f_hist[ih][1]]};
+							unsigned ninst = instances({y, x, w});
+							for (unsigned k = 0; k < ninst; ++k) {
+								double wk = w.at(k);
+								if (wk == 0) continue;
+								((TH2*) h[icut][ih])->Fill(x.at(k), y.at(k), wk);
+								if (count_entries) ((TH2*) h_n[icut][ih])->Fill(x.at(k), y.at(k));
+							}
+						}
+					}
+				}
+			}
+			for (auto& f : formulas) delete f.second;
+			return result;
+		}
+
+	private:
+		vector<cut_booking> cuts;
+		vector<hist_booking> hists;
+
+		static void evaluate(TTreeFormula* f, vector<double>& out) {
+			int ndata = f->GetNdata();
+			out.resize(ndata);
+			for (int k = 0; k < ndata; ++k) out[k] = f->EvalInstance(k);
+		}
+
+		struct column {
+			// The values of one formula in the current entry:
+			const vector<double>* values;
+			bool scalar;
+			double at(unsigned k) const {return (*values)[scalar ? 0 : k];}
+		};
+
+		static unsigned instances(initializer_list<column> columns) {
+			// Scalars broadcast over arrays, and arrays are paired element by element, up to the shortest one (like "TTree::Draw"):
+			unsigned n = 1;
+			bool array = false;
+			for (auto& c : columns) {
+				if (c.values->empty()) return 0;
+				if (c.scalar) continue;
+				n = array ? min<unsigned>(n, c.values->size()) : c.values->size();
+				array = true;
+			}
+			return n;
+		}
+};
+
+#endif
@@ -0,0 +1,352 @@
+// cdf_fitter: fits the average-mass distribution with shifted and stretched
+// templates.
+//
+// Each template is represented by its CDF, interpolated with a monotone cubic
+// (Fritsch-Butland) through the cumulative bin contents, so it can be shifted
+// and stretched by any amount without rebinning. A template with amplitude a,
+// shift s and stretch k predicts, in a fit bin [lo, hi),
+//     a*(F(u(hi)) - F(u(lo))),  with  u(x) = median + (x - median - s)/k,
+// and the fit model is the sum of these over the templates (one template for
+// the closure fits, QCD + ttbar for the stacked fits). The model, and its
+// gradient, are evaluated for all bins at once; the chi2 and its analytic
+// gradient are handed to Minuit2. With "likelihood" set, the Poisson
+// likelihood is used instead, as the likelihood-ratio chi2 of Baker and
+// Cousins,
+//     2*sum(mu - d + d*log(d/mu)),
+// which counts the empty bins too and keeps the usual error definition.
+//
+// No starting values are needed: the shifts and stretches are first scanned on
+// a coarse grid, with the amplitudes set to their best values for each point
+// (a linear least-squares problem), and Migrad starts from the best point.
+//
+// Several fits can be run at once with "fit_cdfs", one thread per fit.
+// Usage:
+//     cdf_fitter fit(h_data, bins);
+//     fit.add_template(h_temp);
+//     fit.fit();
+//     fit.fill(h_fit);                // The post-fit template in h_fit's binning
+//     TH1* params = fit.get_params(); // (a, s, k) for each template, with errors
+
+#ifndef CDF_FITTER
+#define CDF_FITTER
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include "TString.h"
+#include "TH1.h"
+#include "TH1D.h"
+#include "Math/IFunction.h"
+#include "Math/Minimizer.h"
+#include "Math/Factory.h"
+
+using namespace std;
+
+class monotone_cdf {
+	public:
+		vector<double> x, y, slope;     // Knots, and the derivative at each knot
+		double median;
+
+		monotone_cdf() {}
+		monotone_cdf(TH1* h, bool cumulative=false) {
+			// "h" is a template, or (with "cumulative") a CDF like the ones "make_cdf" makes:
+			int n = h->GetNbinsX();
+			x.push_back(h->GetBinLowEdge(1));
+			y.push_back(0);
+			double sum = 0;
+			for (int i = 1; i <= n; ++i) {
+				sum = cumulative ? h->GetBinContent(i) : sum + h->GetBinContent(i);
+				x.push_back(h->GetBinLowEdge(i) + h->GetBinWidth(i));
+				y.push_back(max(sum, y.back()));		// (Negative weights mustn't make it decrease.)
+			}
+			set_slopes();
+			median = quantile(0.5);
+		}
+
+		void eval(const vector<double>& u, vector<double>& F, vector<double>& f) const {
+			// Evaluate the CDF and its derivative at every point of "u", which has to be sorted:
+			F.resize(u.size());
+			f.resize(u.size());
+			unsigned k = 0;
+			for (unsigned i = 0; i < u.size(); ++i) {
+				if (u[i] <= x.front()) {F[i] = 0; f[i] = 0; continue;}
+				if (u[i] >= x.back()) {F[i] = y.back(); f[i] = 0; continue;}
+				while (k + 2 < x.size() && u[i] >= x[k + 1]) k++;
+				double h = x[k + 1] - x[k];
+				double t = (u[i] - x[k])/h;
+				double t2 = t*t, t3 = t2*t;
+				F[i] = (2*t3 - 3*t2 + 1)*y[k] + (t3 - 2*t2 + t)*h*slope[k] + (-2*t3 + 3*t2)*y[k + 1] + (t3 - t2)*h*slope[k + 1];
+				f[i] = ((6*t2 - 6*t)*y[k] + (-6*t2 + 6*t)*y[k + 1])/h + (3*t2 - 4*t + 1)*slope[k] + (3*t2 - 2*t)*slope[k + 1];
+			}
+		}
+
+		double quantile(double q) const {
+			// Bisect for F(u) = q*F(max):
+			double lo = x.front(), hi = x.back();
+			vector<double> u(1), F, f;
+			for (int i = 0; i < 60; ++i) {
+				u[0] = (lo + hi)/2;
+				eval(u, F, f);
+				if (F[0] < q*y.back()) lo = u[0];
+				else hi = u[0];
+			}
+			return (lo + hi)/2;
+		}
+
+	private:
+		void set_slopes() {
+			unsigned n = x.size();
+			slope.assign(n, 0);
+			if (n < 2) return;
+			vector<double> h(n - 1), d(n - 1);
+			for (unsigned i = 0; i + 1 < n; ++i) {
+				h[i] = x[i + 1] - x[i];
+				d[i] = (y[i + 1] - y[i])/h[i];
+			}
+			slope[0] = d[0];
+			slope[n - 1] = d[n - 2];
+			for (unsigned i = 1; i + 1 < n; ++i) {
+				if (d[i - 1] <= 0 || d[i] <= 0) continue;		// Flat on either side: keep it flat
+				slope[i] = 3*(h[i - 1] + h[i])/((2*h[i] + h[i - 1])/d[i - 1] + (h[i] + 2*h[i - 1])/d[i]);
+			}
+		}
+};
+
+class cdf_fitter : public ROOT::Math::IMultiGradFunction {
+	public:
+		vector<monotone_cdf> templates;
+		vector<double> edges, data, variance;
+		vector<double> p, p_error;      // (a, s, k) for each template
+		double chi2 = -1;
+		int ndf = 0, status = -1;
+		bool likelihood = false;        // Poisson likelihood instead of the chi2
+		TString name;
+
+		cdf_fitter(TH1* h_data, vector<double> bins, TString name_in="") : edges(bins), name(name_in) {
+			// Sum the data into the fit bins:
+			data.assign(edges.size() - 1, 0);
+			variance.assign(edges.size() - 1, 0);
+			for (int i = 1; i <= h_data->GetNbinsX(); ++i) {
+				double x = h_data->GetBinCenter(i);
+				if (x < edges.front() || x >= edges.back()) continue;
+				unsigned j = upper_bound(edges.begin(), edges.end(), x) - edges.begin() - 1;
+				data[j] += h_data->GetBinContent(i);
+				variance[j] += pow(h_data->GetBinError(i), 2);
+			}
+		}
+
+		void add_template(TH1* h, bool cumulative=false) {
+			templates.push_back(monotone_cdf(h, cumulative));
+			p.insert(p.end(), {1, 0, 1});
+			p_error.insert(p_error.end(), {0, 0, 0});
+		}
+
+		// The model:
+		void model(const double* par, vector<double>& mu, vector<vector<double>>* grad=0) const {
+			// The prediction in each fit bin, and optionally its derivative with respect to each parameter:
+			unsigned nb = edges.size() - 1;
+			mu.assign(nb, 0);
+			if (grad) grad->assign(3*templates.size(), vector<double>(nb, 0));
+			vector<double> u(edges.size()), F, f;
+			for (unsigned c = 0; c < templates.size(); ++c) {
+				const monotone_cdf& cdf = templates[c];
+				double a = par[3*c], s = par[3*c + 1], k = par[3*c + 2];
+				for (unsigned e = 0; e < edges.size(); ++e) u[e] = cdf.median + (edges[e] - cdf.median - s)/k;
+				cdf.eval(u, F, f);
+				for (unsigned j = 0; j < nb; ++j) {
+					double dF = F[j + 1] - F[j];
+					mu[j] += a*dF;
+					if (!grad) continue;
+					(*grad)[3*c][j] = dF;
+					(*grad)[3*c + 1][j] = -a*(f[j + 1] - f[j])/k;
+					(*grad)[3*c + 2][j] = -a*(f[j + 1]*(edges[j + 1] - cdf.median - s) - f[j]*(edges[j] - cdf.median - s))/(k*k);
+				}
+			}
+		}
+
+		// The chi2, or the likelihood (the "IMultiGradFunction" interface):
+		unsigned int NDim() const override {return 3*templates.size();}
+		ROOT::Math::IMultiGradFunction* Clone() const override {return new cdf_fitter(*this);}
+		void FdF(const double* par, double& value, double* gradient) const override {
+			vector<double> mu;
+			vector<vector<double>> dmu;
+			model(par, mu, &dmu);
+			value = 0;
+			for (unsigned i = 0; i < NDim(); ++i) gradient[i] = 0;
+			for (unsigned j = 0; j < mu.size(); ++j) {
+				if (likelihood) {
+					double m = max(mu[j], 1e-9);		// (The model can't predict nothing where there's data.)
+					value += 2*(m - data[j]);
+					if (data[j] > 0) value += 2*data[j]*log(data[j]/m);
+					double r = 2*(1 - data[j]/m);
+					for (unsigned i = 0; i < NDim(); ++i) gradient[i] += r*dmu[i][j];
+					continue;
+				}
+				if (variance[j] <= 0) continue;		// (Empty bins carry no information in a chi2.)
+				double r = (data[j] - mu[j])/variance[j];
+				value += r*(data[j] - mu[j]);
+				for (unsigned i = 0; i < NDim(); ++i) gradient[i] += -2*r*dmu[i][j];
+			}
+		}
+		void Gradient(const double* par, double* gradient) const override {
+			double value;
+			FdF(par, value, gradient);
+		}
+
+		// Fitting:
+		void seed() {
+			// Scan the shifts and stretches, one template at a time, with the best amplitudes at each point:
+			for (int sweep = 0; sweep < 2; ++sweep) {
+				for (unsigned c = 0; c < templates.size(); ++c) {
+					double best = -1;
+					vector<double> p_best = p;
+					for (double s = -60; s <= 60; s += 5) {
+						for (double k = 0.75; k <= 1.251; k += 0.025) {
+							vector<double> trial = p;
+							trial[3*c + 1] = s;
+							trial[3*c + 2] = k;
+							double value = profile_amplitudes(trial);
+							if (best < 0 || value < best) {
+								best = value;
+								p_best = trial;
+							}
+						}
+					}
+					p = p_best;
+				}
+			}
+		}
+
+		int fit() {
+			seed();
+			ROOT::Math::Minimizer* minimizer = minimizer_in ? minimizer_in : ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
+			minimizer->SetPrintLevel(0);
+			minimizer->SetErrorDef(1);
+			minimizer->SetMaxFunctionCalls(100000);
+			minimizer->SetFunction(*this);
+			for (unsigned c = 0; c < templates.size(); ++c) {
+				TString tag = TString::Format("%d", c + 1);
+				minimizer->SetLowerLimitedVariable(3*c, ("amp" + tag).Data(), p[3*c], max(0.01*p[3*c], 1e-12), 0);
+				minimizer->SetLimitedVariable(3*c + 1, ("shift" + tag).Data(), p[3*c + 1], 1, -200, 200);
+				minimizer->SetLimitedVariable(3*c + 2, ("stretch" + tag).Data(), p[3*c + 2], 0.01, 0.5, 2.0);
+			}
+			minimizer->Minimize();
+			minimizer->Hesse();
+			status = minimizer->Status();
+			for (unsigned i = 0; i < NDim(); ++i) {
+				p[i] = minimizer->X()[i];
+				p_error[i] = minimizer->Errors()[i];
+			}
+			chi2 = minimizer->MinValue();
+			ndf = -(int) NDim();
+			for (auto v : variance) ndf += likelihood || v > 0;
+			delete minimizer;
+			minimizer_in = 0;
+			return status;
+		}
+
+		void prepare() {
+			// Make the minimizer now (the plugin manager isn't thread safe), so that "fit" can run in a thread:
+			if (!minimizer_in) minimizer_in = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
+		}
+
+		// Output:
+		void fill(TH1* h, int component=-1) const {
+			// Fill "h" with the post-fit model (or one template of it) in its own binning:
+			cdf_fitter fine(*this);
+			fine.edges.clear();
+			for (int i = 1; i <= h->GetNbinsX(); ++i) fine.edges.push_back(h->GetBinLowEdge(i));
+			fine.edges.push_back(h->GetBinLowEdge(h->GetNbinsX()) + h->GetBinWidth(h->GetNbinsX()));
+			vector<double> par = p;
+			if (component >= 0) {
+				for (unsigned c = 0; c < templates.size(); ++c) {
+					if ((int) c != component) par[3*c] = 0;
+				}
+			}
+			vector<double> mu;
+			fine.model(&par[0], mu);
+			h->Reset();
+			for (unsigned j = 0; j < mu.size(); ++j) h->SetBinContent(j + 1, mu[j]);
+		}
+
+		TH1* get_params(TString params_name="params") const {
+			TH1* h = new TH1D(params_name, "", NDim(), 0, NDim());
+			for (unsigned i = 0; i < NDim(); ++i) {
+				h->SetBinContent(i + 1, p[i]);
+				h->SetBinError(i + 1, p_error[i]);
+			}
+			return h;
+		}
+
+		void print() const {
+			cout << "[..] Fit " << name << " (status " << status << "): " << (likelihood ? "likelihood " : "") << "chi2/ndf = " << chi2 << "/" << ndf << endl;
+			for (unsigned c = 0; c < templates.size(); ++c) {
+				cout << "\tAmp" << c + 1 << " = " << p[3*c] << " +/- " << p_error[3*c] << endl;
+				cout << "\tShift" << c + 1 << " = " << p[3*c + 1] << " +/- " << p_error[3*c + 1] << endl;
+				cout << "\tStretch" << c + 1 << " = " << p[3*c + 2] << " +/- " << p_error[3*c + 2] << endl;
+			}
+		}
+
+	private:
+		ROOT::Math::Minimizer* minimizer_in = 0;
+
+		double DoEval(const double* par) const override {
+			vector<double> gradient(NDim());
+			double value;
+			FdF(par, value, &gradient[0]);
+			return value;
+		}
+		double DoDerivative(const double* par, unsigned int i) const override {
+			vector<double> gradient(NDim());
+			double value;
+			FdF(par, value, &gradient[0]);
+			return gradient[i];
+		}
+
+		double profile_amplitudes(vector<double>& par) const {
+			// Set the amplitudes in "par" to the ones that minimize the chi2 (the model is linear in them), and return the fit's chi2 (or likelihood) there:
+			unsigned nc = templates.size();
+			vector<double> mu;
+			vector<vector<double>> dmu;
+			model(&par[0], mu, &dmu);
+			vector<vector<double>> A(nc, vector<double>(nc + 1, 0));
+			for (unsigned j = 0; j < mu.size(); ++j) {
+				if (variance[j] <= 0) continue;
+				for (unsigned c = 0; c < nc; ++c) {
+					for (unsigned d = 0; d < nc; ++d) A[c][d] += dmu[3*c][j]*dmu[3*d][j]/variance[j];
+					A[c][nc] += dmu[3*c][j]*data[j]/variance[j];
+				}
+			}
+			/// Gaussian elimination (nc is 1 or 2):
+			for (unsigned c = 0; c < nc; ++c) {
+				if (A[c][c] == 0) continue;
+				for (unsigned d = 0; d < nc; ++d) {
+					if (d == c) continue;
+					double factor = A[d][c]/A[c][c];
+					for (unsigned e = c; e <= nc; ++e) A[d][e] -= factor*A[c][e];
+				}
+			}
+			for (unsigned c = 0; c < nc; ++c) par[3*c] = A[c][c] > 0 ? max(A[c][nc]/A[c][c], 0.0) : 0;
+			return (*this)(&par[0]);
+		}
+};
+
+void fit_cdfs(vector<cdf_fitter*> fits, unsigned n_threads=0) {
+	// Run several fits at once:
+	if (n_threads == 0) n_threads = max(1u, thread::hardware_concurrency());
+	for (auto fit : fits) fit->prepare();
+	atomic<unsigned> next(0);
+	vector<thread> threads;
+	for (unsigned t = 0; t < min<unsigned>(n_threads, fits.size()); ++t) {
+		threads.push_back(thread([&]() {
+			for (unsigned i = next++; i < fits.size(); i = next++) fits[i]->fit();
+		}));
+	}
+	for (auto& t : threads) t.join();
+	for (auto fit : fits) fit->print();
+}
+
+#endif
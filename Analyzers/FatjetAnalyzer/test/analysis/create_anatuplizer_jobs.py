@@ -42,7 +42,7 @@ def main():
 		print "\t{}".format(tuples)
 	
 	ana = analyzer.analyzer(tuples, v=args.verbose, count=False)
-	path = ana.create_jobs(cmd="python anatuplizer.py --condor %%N%% -f %%FILE%% -p %%PROCESS%%", input_files=["anatuplizer.py", "anatuple.yaml"])
+	path = ana.create_jobs(cmd="python anatuplizer.py --condor %%N%% -f %%FILE%% -p %%PROCESS%%", input_files=["anatuplizer.py", "anatuplizer.cc", "anatuple.yaml"])
 	condor.tar_cmssw(path)
 # /FUNCTIONS
 
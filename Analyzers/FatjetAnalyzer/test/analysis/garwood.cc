@@ -0,0 +1,172 @@
+// garwood: Garwood (central Poisson) intervals for weighted histograms.
+//
+// A bin of a weighted histogram is described by its sum of weights W, its sum
+// of squared weights W2, and its raw number of entries n. It's treated as a
+// scaled Poisson count: n_eff = W^2/W2 effective entries, each with the weight
+// s = W2/W, and the interval is s times the Garwood interval of n_eff,
+//     [s*Q(alpha/2, n_eff), s*Q(1 - alpha/2, n_eff + 1)],
+// where Q(p, a) is the quantile of a gamma distribution with shape a. When all
+// of the weights in a bin are the same, n_eff = n, and the quantiles come from
+// a table made once for small n. Otherwise they come from a Wilson-Hilferty
+// guess polished with a few Newton steps, which is much faster than the old
+// way of building the interval from each weight's contribution.
+//
+// An empty bin gets [0, s*Q(1 - alpha/2, 1)], with s the average effective
+// weight of the whole histogram.
+//
+// The (W, W2, n) of every bin come from one pass over the tree: "fill_garwood"
+// books the plots in "booked_plotter" with "count_entries" set, so the sums of
+// weights are in the histograms (with "Sumw2") and n is in "counts". Rebin the
+// three together before making the intervals; the intervals don't add.
+//
+// From a macro:
+//     garwood_intervals garwood;
+//     TH1D* h = garwood.make_hist(h_w, h_n, "gar");       // Symmetrized errors, for fits
+//     TGraphAsymmErrors* g = garwood.make_graph(h_w, h_n, "gar_graph");
+
+#ifndef GARWOOD
+#define GARWOOD
+
+#include <Analyzers/FatjetAnalyzer/test/analysis/booked_plotter.cc>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "TString.h"
+#include "TMath.h"
+#include "TTree.h"
+#include "TH1.h"
+#include "TH1D.h"
+#include "TGraphAsymmErrors.h"
+
+using namespace std;
+
+class garwood_intervals {
+	public:
+		double cl;
+		vector<double> table_lo, table_hi;      // Q(alpha/2, n) and Q(1 - alpha/2, n + 1) for n = 0, 1, ...
+
+		garwood_intervals(double cl_in=0.682689492, int n_table=500) : cl(cl_in) {
+			double alpha = 1 - cl;
+			for (int n = 0; n <= n_table; ++n) {
+				table_lo.push_back(n > 0 ? gamma_quantile(alpha/2, n) : 0);
+				table_hi.push_back(gamma_quantile(1 - alpha/2, n + 1));
+			}
+		}
+
+		static double gamma_quantile(double p, double a) {
+			// The x with P(a, x) = p, where P is the regularized lower incomplete gamma function:
+			if (a <= 0 || p <= 0) return 0;
+			double z = TMath::NormQuantile(p);
+			double x = a*pow(1 - 1/(9*a) + z/(3*sqrt(a)), 3);		// Wilson-Hilferty
+			if (a > 200 && x > 0) return x;		// (Good to better than 1e-5 here.)
+			double lng = TMath::LnGamma(a);
+			if (x <= 0) x = exp((log(p) + log(a) + lng)/a);		// Small x: P(a, x) ~ x^a/Gamma(a + 1)
+			for (int i = 0; i < 20; ++i) {
+				double step = (TMath::Gamma(a, x) - p)/exp((a - 1)*log(x) - x - lng);
+				double x_new = x - step;
+				if (x_new <= 0) x_new = x/2;
+				if (fabs(x_new - x) < 1e-10*x) return x_new;
+				x = x_new;
+			}
+			return x;
+		}
+
+		void interval(double w, double w2, double n, double scale_empty, double& lo, double& hi) const {
+			// The interval of one bin, from its sum of weights, sum of squared weights, and raw entries:
+			if (w <= 0 || w2 <= 0) {
+				lo = 0;
+				hi = scale_empty*quantile_hi(0);
+				return;
+			}
+			double n_eff = w*w/w2, scale = w2/w;
+			if (n > 0 && fabs(n_eff - n) < 1e-6*n) n_eff = n;		// All of the weights are the same
+			lo = scale*quantile_lo(n_eff);
+			hi = scale*quantile_hi(n_eff);
+		}
+
+		void intervals(const vector<double>& w, const vector<double>& w2, const vector<double>& n, vector<double>& lo, vector<double>& hi) const {
+			// The intervals of every bin at once:
+			double w_sum = 0, w2_sum = 0;
+			for (unsigned i = 0; i < w.size(); ++i) {
+				if (w[i] > 0) w_sum += w[i];
+				w2_sum += w2[i];
+			}
+			double scale_empty = w_sum > 0 ? w2_sum/w_sum : 1;
+			lo.resize(w.size());
+			hi.resize(w.size());
+			for (unsigned i = 0; i < w.size(); ++i) interval(w[i], w2[i], i < n.size() ? n[i] : 0, scale_empty, lo[i], hi[i]);
+		}
+
+		void intervals(const TH1* h_w, const TH1* h_n, vector<double>& lo, vector<double>& hi) const {
+			// The intervals of the bins 1 to N of a histogram and its raw entries ("h_n" can be 0):
+			int nbins = h_w->GetNbinsX();
+			vector<double> w(nbins), w2(nbins), n(nbins, 0);
+			for (int i = 0; i < nbins; ++i) {
+				w[i] = h_w->GetBinContent(i + 1);
+				w2[i] = pow(h_w->GetBinError(i + 1), 2);
+				if (h_n) n[i] = h_n->GetBinContent(i + 1);
+			}
+			intervals(w, w2, n, lo, hi);
+		}
+
+		TH1D* make_hist(const TH1* h_w, const TH1* h_n, TString name) const {
+			// A copy of "h_w" with each bin error set to the average of its Garwood errors:
+			vector<double> lo, hi;
+			intervals(h_w, h_n, lo, hi);
+			TH1D* h = new TH1D(name, "", h_w->GetNbinsX(), ((TH1*) h_w)->GetXaxis()->GetXmin(), ((TH1*) h_w)->GetXaxis()->GetXmax());
+			h->SetDirectory(0);
+			h->Sumw2();
+			for (int i = 1; i <= h_w->GetNbinsX(); ++i) {
+				double y = h_w->GetBinContent(i);
+				h->SetBinContent(i, y);
+				h->SetBinError(i, (hi[i - 1] - lo[i - 1])/2);
+			}
+			return h;
+		}
+
+		TGraphAsymmErrors* make_graph(const TH1* h_w, const TH1* h_n, TString name) const {
+			vector<double> lo, hi;
+			intervals(h_w, h_n, lo, hi);
+			TGraphAsymmErrors* g = new TGraphAsymmErrors(h_w->GetNbinsX());
+			g->SetName(name);
+			for (int i = 1; i <= h_w->GetNbinsX(); ++i) {
+				double x = h_w->GetBinCenter(i), dx = h_w->GetBinWidth(i)/2, y = h_w->GetBinContent(i);
+				g->SetPoint(i - 1, x, y);
+				g->SetPointError(i - 1, dx, dx, max(y - lo[i - 1], 0.0), max(hi[i - 1] - y, 0.0));
+			}
+			return g;
+		}
+
+	private:
+		double quantile_lo(double n) const {
+			if (n == floor(n) && n < table_lo.size()) return table_lo[(int) n];
+			return gamma_quantile((1 - cl)/2, n);
+		}
+		double quantile_hi(double n) const {
+			if (n == floor(n) && n < table_hi.size()) return table_hi[(int) n];
+			return gamma_quantile(1 - (1 - cl)/2, n + 1);
+		}
+};
+
+vector<TH1D*> fill_garwood(TTree* tt, TString expression, vector<TString> cut_keys, vector<TString> selections, int n, double lo, double hi, int nrebin=1, TString name="gar") {
+	// Fill "expression" for each selection in one pass over "tt", and make the Garwood plots ("<name>_<cut_key>"):
+	booked_plotter plotter;
+	plotter.count_entries = true;
+	for (unsigned i = 0; i < selections.size(); ++i) plotter.add_cut(cut_keys[i], selections[i]);
+	plotter.book_th1(name, expression, n, lo, hi);
+	vector<TH1*> hs = plotter.fill(tt);
+	garwood_intervals garwood;
+	vector<TH1D*> result;
+	for (unsigned i = 0; i < hs.size(); ++i) {
+		if (nrebin > 1) {
+			hs[i]->Rebin(nrebin);
+			plotter.counts[i]->Rebin(nrebin);
+		}
+		result.push_back(garwood.make_hist(hs[i], plotter.counts[i], name + "_" + cut_keys[i]));
+		delete hs[i];
+		delete plotter.counts[i];
+	}
+	return result;
+}
+
+#endif
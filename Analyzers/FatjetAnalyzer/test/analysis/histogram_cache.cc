@@ -0,0 +1,131 @@
+// histogram_cache: a persistent cache of filled histograms for the study macros.
+//
+// Each histogram is stored in "histogram_cache.root" under the MD5 of its key,
+//     (anatuple file, tree, entries, expression, selection, binning),
+// where the anatuple file is identified by its UUID and size, which ROOT writes
+// into the file header. (Hashing the contents of a multi-GB anatuple would cost
+// as much as reading it again.) The selection includes the weight, like the
+// TCut that "get_cut" returns. Anything that changes the key makes a new entry,
+// so a cached histogram is never stale.
+//
+// Request every histogram first, then "fill": the missing histograms of each
+// tree are filled together from one loop over that tree (with booked_plotter),
+// and the others are read from the cache without opening the tree's baskets.
+//     histogram_cache cache;
+//     int i = cache.request(tt, "qcdp_sig", "mavg_p", get_cut("fjp_sig"), 1200, 0, 1200);
+//     cache.fill();
+//     TH1* h = cache.at(i);
+// or, for a single histogram, replace
+//     tt->Draw("mavg_p>>qcdp_sig(1200, 0, 1200)", get_cut("fjp_sig"));
+// with
+//     TH1* h = cached_draw(tt, "qcdp_sig", "mavg_p", get_cut("fjp_sig"), 1200, 0, 1200);
+
+#ifndef HISTOGRAM_CACHE
+#define HISTOGRAM_CACHE
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TH1.h"
+#include "TMD5.h"
+#include "TUUID.h"
+#include "TSystem.h"
+#include <Analyzers/FatjetAnalyzer/test/analysis/booked_plotter.cc>
+
+using namespace std;
+
+class histogram_cache {
+	public:
+		histogram_cache(TString path_in="histogram_cache.root") : path(path_in) {}
+
+		int request(TTree* tt, TString name, TString expression, TString selection, int n, double lo, double hi) {
+			TString description = tree_key(tt) + "|" + expression + "|" + selection + "|" + TString::Format("%d|%.10g|%.10g", n, lo, hi);
+			requests.push_back({tt, name, expression, selection, n, lo, hi, digest(description), 0});
+			return requests.size() - 1;
+		}
+
+		void fill() {
+			// Read what's cached:
+			TFile* tf_cache = gSystem->AccessPathName(path) ? 0 : TFile::Open(path);
+			map<TTree*, vector<int>> missing;
+			for (unsigned i = 0; i < requests.size(); ++i) {
+				request_info& r = requests[i];
+				if (r.h) continue;
+				TH1* h = tf_cache ? (TH1*) tf_cache->Get("h_" + r.key) : 0;
+				if (h) r.h = finish(h, r.name);
+				else missing[r.tt].push_back(i);
+			}
+			if (tf_cache) tf_cache->Close();
+			if (missing.empty()) return;
+
+			// Fill what isn't, one loop per tree:
+			tf_cache = TFile::Open(path, "UPDATE");
+			for (auto& tree_missing : missing) {
+				TTree* tt = tree_missing.first;
+				cout << "[..] Filling " << tree_missing.second.size() << " uncached histogram(s) from " << tt->GetName() << "." << endl;
+				/// Requests with the same selection share a cut, so group them:
+				map<TString, vector<int>> groups;
+				for (int i : tree_missing.second) groups[requests[i].selection].push_back(i);
+				for (auto& group : groups) {
+					booked_plotter plotter;
+					plotter.add_cut("c", group.first);
+					for (int i : group.second) plotter.book_th1(TString::Format("v%d", i), requests[i].expression, requests[i].n, requests[i].lo, requests[i].hi);
+					vector<TH1*> hs = plotter.fill(tt);		// In booking order
+					for (unsigned k = 0; k < hs.size(); ++k) {
+						request_info& r = requests[group.second[k]];
+						tf_cache->WriteTObject(hs[k], "h_" + r.key, "Overwrite");
+						r.h = finish(hs[k], r.name);
+						delete hs[k];
+					}
+				}
+			}
+			tf_cache->Close();
+		}
+
+		TH1* at(int i) {return requests[i].h;}
+
+	private:
+		struct request_info {
+			TTree* tt;
+			TString name, expression, selection;
+			int n;
+			double lo, hi;
+			TString key;
+			TH1* h;
+		};
+		TString path;
+		vector<request_info> requests;
+
+		static TString tree_key(TTree* tt) {
+			TFile* tf = tt->GetCurrentFile();
+			TString file_key = tf ? tf->GetUUID().AsString() + TString::Format("|%lld", tf->GetSize()) : TString("memory");
+			return file_key + "|" + tt->GetName() + TString::Format("|%lld", tt->GetEntries());
+		}
+
+		static TString digest(TString description) {
+			TMD5 md5;
+			md5.Update((const unsigned char*) description.Data(), description.Length());
+			md5.Final();
+			return md5.AsString();
+		}
+
+		static TH1* finish(TH1* h, TString name) {
+			// Return a copy named like "TTree::Draw" would have named it:
+			TH1* result = (TH1*) h->Clone(name);
+			result->SetDirectory(0);
+			result->SetTitle("");
+			return result;
+		}
+};
+
+TH1* cached_draw(TTree* tt, TString name, TString expression, TString selection, int n, double lo, double hi, TString path="histogram_cache.root") {
+	histogram_cache cache(path);
+	int i = cache.request(tt, name, expression, selection, n, lo, hi);
+	cache.fill();
+	return cache.at(i);
+}
+
+#endif
@@ -14,6 +14,7 @@ from truculence import analysis, root
 # :CLASSES
 
 # VARIABLES:
+engine = "cc"		# "cc": fill everything from one loop per tree with "booked_plotter.cc"; "draw": one "TTree::Draw" per histogram
 # :VARIABLES
 
 # FUNCTIONS:
@@ -29,6 +30,18 @@ def get_cuts(path="plotter_cuts.yaml"):
 #	tts = analysis.get_tobjects(tf_in, kind="ttree")
 #	return tts
 
+def book(plot_info, cuts_dict):
+	gROOT.ProcessLine(".L booked_plotter.cc+")
+	from ROOT import booked_plotter
+	plotter = booked_plotter()
+	for cut_key, tcut in cuts_dict.items():
+		plotter.add_cut(cut_key, tcut.GetTitle())
+	for var_name, info in plot_info["th1"].items():
+		plotter.book_th1(var_name, info["var"], *info["binning"])
+	for var_name, info in plot_info["th2"].items():
+		plotter.book_th2(var_name, info["var"][0], info["var"][1], *info["binning"])
+	return plotter
+
 def main():
 	# Input:
 	## Anatuple:
@@ -59,6 +72,14 @@ def main():
 		tcut.Write()
 	
 	# Write histograms:
+	if engine == "cc":
+		plotter = book(plot_info, cuts_dict)
+		for tt in tts:
+			print "[..] Plotting everything for {}.".format(tt.GetName())
+			for th in plotter.fill(tt):
+				tf_out.WriteTObject(th)
+		print "[OK] Plots sucessfully written to\n\t{}".format(f_out)
+		return True
 	for cut_key, tcut in cuts_dict.items():
 		print "[..] Making plots for {}, which is\n\t{}".format(cut_key, tcut.GetTitle())
 		# TH1s:
@@ -2,6 +2,7 @@
 #include <sstream>
 #include <string>
 #include <Deracination/Straphanger/test/decortication/macros/common.cc>
+#include <Analyzers/FatjetAnalyzer/test/analysis/cdf_fitter.cc>
 
 bool VERBOSE = true;
 
@@ -28,15 +29,7 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 	
 	// Perform fits:
 	vector<double> bins;
-//	/// Best guesses for the amplitude, shift, and stretch:
-	double newAmp1 = 8.0e-7;       // Floats
-	double newShift1 = 0.0;        // Floats
-	double newStretch1 = 1.0;      // Floats
-	double newAmp2 = 1.0;          // Floats
-	double newShift2 = 0.0;        // Floats
-	double newStretch2 = 1.0;      // Floats
-//	double newAmp1, newShift1, newStretch1, newAmp2, newShift2, newStretch2;
-	double newAmpe1, newShifte1, newStretche1, newAmpe2, newShifte2, newStretche2;
+	/// (The amplitudes, shifts, and stretches need no starting values: "cdf_fitter" scans for them.)
 //	if (cut_name == "sbb") {
 //		bins = {0, 100, 150, 200, 250, 300, 350, 400, 450, 500, 600};
 //		newAmp1 = 2.0e-6;
@@ -50,12 +43,6 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 		if (f == 0) {
 	//		bins = {50, 100, 150, 200, 250, 300, 350, 400, 450, 500, 550, 600};
 			bins = {0, 60, 80, 100, 110, 120, 130, 140, 150, 160, 170, 180, 190, 200, 210, 220, 230, 240, 250, 260, 280, 300, 310, 320, 330, 340, 350, 360, 400, 420, 440, 480, 500, 540, 600};
-			newAmp1 = 2.0e-6;
-			newShift1 = -11;
-			newStretch1 = 1.00;
-			newAmp2 = 0.90;
-			newShift2 = 2.0;
-			newStretch2 = 1.0;
 		}
 		else if (f == 1) {
 			bins = {0, 60, 90, 120, 130, 140, 150, 180, 210, 240, 270, 300, 330, 360, 390, 420, 480, 540, 600};
@@ -63,22 +50,10 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 			bins = {0, 60, 90, 100, 110, 120, 130, 140, 150, 180, 210, 220, 240, 270, 300, 330, 360, 390, 420, 480, 540, 600};
 			bins = {0, 60, 90, 100, 110, 120, 130, 140, 150, 180, 210, 220, 240, 270, 300, 330, 360, 390, 420, 450, 480, 510, 540};
 //			newAmp1 = 4e-7;
-			newAmp1 = 0.5;
-			newShift1 = -15;
-			newStretch1 = 1.1;
-			newAmp2 = 0.95;
-			newShift2 = 5;
-			newStretch2 = 1.1;
 			
 			if (inj == "inj") {
 				bins = {30, 60, 90, 120, 150, 180, 210, 220, 240, 270, 300, 330, 390, 420, 450, 480, 510};
 	//			newAmp1 = 4e-7;
-				newAmp1 = 0.45;
-				newShift1 = -15;
-				newStretch1 = 1.1;
-				newAmp2 = 0.95;
-				newShift2 = 5;
-				newStretch2 = 1.1;
 			}
 		}
 	}
@@ -86,12 +61,6 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 		if (f == 0) {
 	//		bins = {0, 100, 150, 200, 250, 300, 350, 400, 500};
 			bins = {0, 60, 80, 100, 120, 140, 160, 180, 200, 220, 240, 280, 300, 320, 340, 360, 400, 440, 480, 500, 540, 600};
-			newAmp1 = 2.0e-6;
-			newShift1 = -20;
-			newStretch1 = 0.95;
-			newAmp2 = 0.95;
-			newShift2 = 0.0;
-			newStretch2 = 1.24;
 		}
 		else if (f == 1) {
 			// Before variable HT binning and tau42 change:
@@ -105,12 +74,6 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 
 //			bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 250, 270, 300, 330, 360, 420, 480, 540, 600, 660, 810};
 			bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 390, 420, 450, 480, 510, 540, 570, 600, 630, 660, 690, 720, 750, 780, 810, 840, 870, 900, 930, 960, 990, 1020, 1050, 1080, 1110, 1140, 1170, 1200};
-			newAmp1 = 0.85;
-			newShift1 = -20;
-			newStretch1 = 1.0;
-			newAmp2 = 1.0;
-			newShift2 = 5.0;
-			newStretch2 = 1.0;
 //			newAmp1 = 0.80;
 //			newShift1 = -17;
 //			newStretch1 = 0.97;
@@ -120,12 +83,6 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 			
 			if (inj == "inj") {
 				bins = {60, 90, 120, 150, 180, 210, 240, 250, 270, 300, 330, 360, 420, 480, 540, 600, 660, 810};
-				newAmp1 = 0.85;
-				newShift1 = -20;
-				newStretch1 = 1.0;
-				newAmp2 = 1.0;
-				newShift2 = 5.0;
-				newStretch2 = 1.0;
 			}
 		}
 	}
@@ -134,54 +91,24 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 	//		bins = {0, 100, 150, 200, 250, 300, 400, 500, 600, 700};
 	//		bins = {40, 80, 120, 160, 180, 200, 250, 300, 350, 400, 450, 500, 600, 700};
 			bins = {50, 100, 150, 200, 250, 300, 350, 400, 450, 500, 600};
-			newAmp1 = 4e-7;
-			newShift1 = -20;
-			newStretch1 = 1.0;
-			newAmp2 = 0.90;
-			newShift2 = 0.0;
-			newStretch2 = 1.0;
 		}
 		else if (f == 1) {
 //			bins = {20, 80, 120, 130, 140, 150, 160, 170, 180, 190, 200, 210, 220, 230, 240, 250, 300, 350, 400, 450, 500, 550, 600, 650, 700};	// worked before lum change
 			bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 360, 420, 480, 600};
 //			newAmp1 = 4e-7;
-			newAmp1 = 0.70;
-			newShift1 = -20.0;
-			newStretch1 = 0.90;
-			newAmp2 = 1.00;
-			newShift2 = 0.0;
-			newStretch2 = 1.0;
 		}
 	}
 	else if (cut_name == "sbl") {
 		if (f == 0) {
 	//		bins = {0, 100, 150, 200, 250, 300, 350, 400, 500};
 			bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 390, 420, 480, 510, 540, 600};
-			newAmp1 = 4e-7;
-			newShift1 = -20;
-			newStretch1 = 0.90;
-			newAmp2 = 0.9;
-			newShift2 = 1.0;
-			newStretch2 = 1.0;
 		}
 		else if (f == 1) {
 			// Before variable HT binning:
 			bins = {90, 95, 100, 105, 110, 115, 120, 125, 130, 135, 140, 145, 150, 155, 160, 165, 170, 175, 180, 185, 190, 195, 200, 205, 210, 215, 220, 225, 230, 235, 240, 245, 250, 260, 270, 300, 330, 360, 390, 420, 480, 540};
-			newAmp1 = 1.0;
-			newShift1 = -20;
-			newStretch1 = 0.90;
-			newAmp2 = 1.0;
-			newShift2 = 0.0;
-			newStretch2 = 1.0;
 			
 			if (inj == "inj") {
 				bins = {90, 95, 100, 105, 110, 115, 120, 125, 130, 135, 140, 145, 150, 155, 160, 165, 170, 175, 180, 185, 190, 195, 200, 205, 210, 215, 220, 225, 230, 235, 240, 245, 250, 260, 270, 300, 330, 360, 390, 420, 480, 540, 600};
-				newAmp1 = 1.0;
-				newShift1 = -30;
-				newStretch1 = 0.90;
-				newAmp2 = 1.0;
-				newShift2 = 1.0;
-				newStretch2 = 1.0;
 			}
 
 ////			bins = {90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 390, 420, 450, 480, 520, 540, 570, 600};
@@ -196,22 +123,10 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 	}
 	else if (cut_name == "pretsbl") {
 		bins = {30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 420, 480, 540, 600};
-		newAmp1 = 0.9;
-		newShift1 = 0;
-		newStretch1 = 0.9;
-		newAmp2 = 1.0;
-		newShift2 = 1.0;
-		newStretch2 = 0.9;
 	}
 	else if (cut_name == "sbl42b") {
 		bins = {0, 30, 60, 90, 100, 120, 130, 150, 180, 210, 240, 270, 300, 330, 360, 420, 480, 540};
 //			newAmp1 = 4e-7;
-		newAmp1 = 0.8;
-		newShift1 = -20;
-		newStretch1 = 0.95;
-		newAmp2 = 0.90;
-		newShift2 = 5.0;
-		newStretch2 = 1.1;
 	}
 	else if (cut_name == "sbl42") {
 //		bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 420, 480, 540, 600, 660};
@@ -220,12 +135,6 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 //		bins = {60, 90, 120, 150, 180, 210, 240, 270, 300, 360, 420, 480, 540, 600};
 		bins = {0, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 420, 480};
 //			newAmp1 = 4e-7;
-		newAmp1 = 0.80;
-		newShift1 = -21;
-		newStretch1 = 0.95;
-		newAmp2 = 0.90;
-		newShift2 = 5.0;
-		newStretch2 = 1.1;
 	}
 	else if (cut_name == "sbl43b") {		// chi2
 //		bins = {0, 70, 80, 90, 120, 130, 140, 150, 170, 190, 200, 210, 220, 240, 300, 330, 360, 420, 450};
@@ -233,73 +142,31 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 //		bins = {0, 90, 120, 150, 180, 210, 240, 300, 330, 360, 420, 600, 1200};
 		bins = {60, 120, 150, 180, 210, 240, 270, 300, 330, 360, 390};
 //			newAmp1 = 4e-7;
-		newAmp1 = 0.15;
-		newShift1 = -25;
-		newStretch1 = 1.20;
-		newAmp2 = 0.80;
-		newShift2 = -10.0;
-		newStretch2 = 0.8;
 	}
 	else if (cut_name == "sbl43") {
 		bins = {0, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 420, 480, 540, 600, 660};
 //			newAmp1 = 4e-7;
-		newAmp1 = 0.8;
-		newShift1 = -20;
-		newStretch1 = 0.95;
-		newAmp2 = 0.90;
-		newShift2 = 5.0;
-		newStretch2 = 1.1;
 	}
 	else if (cut_name == "sbtb") {
 		if (f == 0) {
 	//		bins = {0, 100, 150, 200, 250, 300, 350, 400, 450, 700};
 			bins = {50, 100, 150, 200, 250, 300, 350, 400, 450, 500};		// chi2
-			newAmp1 = 2e-6;
-			newShift1 = 30;
-			newStretch1 = 0.75;
-			newAmp2 = 1.3;
-			newShift2 = -20.0;
-			newStretch2 = 1.1;
 		}
 		else if (f == 1) {
 			bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 420, 480, 540, 660}; // chi2
-			newAmp1 = 4e-7;
-			newShift1 = 0;
-			newStretch1 = 1.0;
-			newAmp2 = 1.0;
-			newShift2 = -20.0;
-			newStretch2 = 1.0;
 		}
 	}
 	else if (cut_name == "sbt") {
 		if (f == 0) {
 //			bins = {80, 100, 120, 130, 140, 150, 160, 180, 200, 250, 300, 350, 400, 420, 440, 460};
 			bins = {0, 60, 90, 120, 150, 180, 210, 240, 300, 360, 420, 480, 540, 660};
-			newAmp1 = 1.2e-6;
-			newShift1 = -20;
-			newStretch1 = 1.00;
-			newAmp2 = 1.0;
-			newShift2 = -10.0;
-			newStretch2 = 1.0;
 		}
 		else if (f == 1) {
 			bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 360, 390, 420, 450, 480, 510, 540, 570, 600};
-			newAmp1 = 0.8;
-			newShift1 = -20;
-			newStretch1 = 1.00;
-			newAmp2 = 1.0;
-			newShift2 = -10.0;
-			newStretch2 = 1.0;
 		}
 	}
 	else if (cut_name == "sbideb") {
 		bins = {0, 150, 180, 210, 240, 300, 330, 360, 390, 420, 450, 480, 900};
-		newAmp1 = 1.0;
-		newShift1 = 20.0;
-		newStretch1 = 1.00;
-		newAmp2 = 1.0;
-		newShift2 = -20.0;
-		newStretch2 = 1.1;
 	}
 	else if (cut_name == "sbide") {
 //		bins = {60, 120, 150, 180, 210, 240, 270, 300, 330, 360, 390, 420, 450, 480, 510, 540, 570};
@@ -311,66 +178,36 @@ void analysis_styler_sim(TString cut_name="sb", TString inj="", int f=1, int nre
 //		newShift2 = -10.0;
 //		newStretch2 = 1.0;
 		bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 390, 510, 540, 570, 600, 630};
-		newAmp1 = 1.0;
-		newShift1 = 30.0;
-		newStretch1 = 1.00;
-		newAmp2 = 1.0;
-		newShift2 = -30.0;
-		newStretch2 = 0.97;
 	}
 	else if (cut_name == "sig") {
 //		bins = {60, 120, 150, 180, 210, 240, 270, 300, 330, 360, 390, 420, 450, 480, 510, 540, 570};
 //		bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360, 390, 420, 450, 480, 510, 540, 570, 600, 630, 660, 690};
 		bins = {0, 30, 60, 90, 120, 150, 180, 210, 240, 300, 330, 360, 390, 420, 450, 480, 510, 540, 570, 600, 630, 660};
-		newAmp1 = 0.8;
-		newShift1 = -10;
-		newStretch1 = 1.00;
-		newAmp2 = 1.1;
-		newShift2 = -10.0;
-		newStretch2 = 0.90;
 	}
 	else if (cut_name == "sig15") {
 //		bins = {60, 120, 150, 180, 210, 240, 270, 300, 330, 360, 390, 420, 450, 480, 510, 540, 570};
 		bins = {0, 50, 150, 200, 250, 300, 350, 400, 450, 500, 550, 600};
-		newAmp1 = 1.0;
-		newShift1 = 0.0;
-		newStretch1 = 1.00;
-		newAmp2 = 1.0;
-		newShift2 = -10.0;
-		newStretch2 = 1.0;
-	}
-	if (cut_name != "sbtb" && cut_name != "sbideb" && cut_name != "sbl43b" && cut_name != "sig15") perform_stacked_fit(h_fjp_jetht, h_cdf_jetht, h_cdf_ttbar, bins, newAmp1, newAmpe1, newShift1, newShifte1, newStretch1, newStretche1, newAmp2, newAmpe2, newShift2, newShifte2, newStretch2, newStretche2);
-	else perform_stacked_fit_chi(h_fjp_jetht, h_cdf_jetht, h_cdf_ttbar, bins, newAmp1, newAmpe1, newShift1, newShifte1, newStretch1, newStretche1, newAmp2, newAmpe2, newShift2, newShifte2, newStretch2, newStretche2);
-	
-	if (VERBOSE) {
-		std::cout << "Amp1=" << newAmp1 << " +/- " << newAmpe1 << std::endl;
-		std::cout << "Shift1=" << newShift1 << " +/- " << newShifte1 << std::endl;
-		std::cout << "Stretch1=" << newStretch1 << " +/- " << newStretche1 << std::endl;
-		std::cout << "Amp2=" << newAmp2 << " +/- " << newAmpe2 << std::endl;
-		std::cout << "Shift2=" << newShift2 << " +/- " << newShifte2 << std::endl;
-		std::cout << "Stretch2=" << newStretch2 << " +/- " << newStretche2 << std::endl;
 	}
+	/// QCD and ttbar are fit together (with the Poisson likelihood, except for the chi2 cuts "sbtb", "sbideb", "sbl43b", and "sig15"):
+	cdf_fitter fit(h_fjp_jetht, bins, "jetht_" + cut_name);
+	fit.likelihood = cut_name != "sbtb" && cut_name != "sbideb" && cut_name != "sbl43b" && cut_name != "sig15";
+	fit.add_template(h_cdf_jetht, true);
+	fit.add_template(h_cdf_ttbar, true);
+	fit.fit();
+	if (VERBOSE) fit.print();
+	double newAmp1 = fit.p[0], newShift1 = fit.p[1], newStretch1 = fit.p[2];
+	double newAmp2 = fit.p[3], newShift2 = fit.p[4], newStretch2 = fit.p[5];
+	double newAmpe1 = fit.p_error[0], newShifte1 = fit.p_error[1], newStretche1 = fit.p_error[2];
+	double newAmpe2 = fit.p_error[3], newShifte2 = fit.p_error[4], newStretche2 = fit.p_error[5];
 	
 	// Save fit parameters into a histogram:
-	TH1D* h_fit_params = new TH1D("params", "", 6, 0, 6);
-	h_fit_params->SetBinContent(1, newAmp1);
-	h_fit_params->SetBinError(1, newAmpe1);
-	h_fit_params->SetBinContent(2, newShift1);
-	h_fit_params->SetBinError(2, newShifte1);
-	h_fit_params->SetBinContent(3, newStretch1);
-	h_fit_params->SetBinError(3, newStretche1);
-	h_fit_params->SetBinContent(4, newAmp2);
-	h_fit_params->SetBinError(4, newAmpe2);
-	h_fit_params->SetBinContent(5, newShift2);
-	h_fit_params->SetBinError(5, newShifte2);
-	h_fit_params->SetBinContent(6, newStretch2);
-	h_fit_params->SetBinError(6, newStretche2);
+	TH1* h_fit_params = fit.get_params();
 	
 	// Make fit plots:
 	TH1* h_fit_jetht = (TH1*) h_temp_jetht->Clone("fit_jetht");
-	differentiate_cdf(h_cdf_jetht, h_fit_jetht, median_from_cdf(h_cdf_jetht), newAmp1, newShift1, newStretch1);
+	fit.fill(h_fit_jetht, 0);
 	TH1* h_fit_ttbar = (TH1*) h_fjp_ttbar->Clone("fit_ttbar");
-	differentiate_cdf(h_cdf_ttbar, h_fit_ttbar, median_from_cdf(h_cdf_ttbar), newAmp2, newShift2, newStretch2);
+	fit.fill(h_fit_ttbar, 1);
 	
 	// Styling:
 	h_fit_jetht->Rebin(nrebin);
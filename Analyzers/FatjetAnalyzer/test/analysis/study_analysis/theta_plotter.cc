@@ -2,10 +2,11 @@
 #include <sstream>
 #include <string>
 #include <Deracination/Straphanger/test/decortication/macros/common.cc>
+#include <Analyzers/FatjetAnalyzer/test/analysis/template_variations.cc>
 
 bool VERBOSE = true;
 
-void make_plots(TString name, TFile* tf_out, TH1* h_fjp, TH1* h_cdf, TH1* params, int first_param, int nrebin, TH1* params_out, int params_out_offset, bool signal=false) {
+void make_plots(TString name, TFile* tf_out, TH1* h_fjp, TH1* h_cdf, TH1* params, int first_param, int nrebin, TH1* params_out, int params_out_offset, bool signal=false, TH1* params_replicas=0) {
 //	h->SetName(name);
 	cout << name << endl;
 	
@@ -76,29 +77,17 @@ void make_plots(TString name, TFile* tf_out, TH1* h_fjp, TH1* h_cdf, TH1* params
 //		shifte = 33.1;
 //		stretche = 0.055;
 	}
+	// The template's statistical uncertainty, from the spread of the bootstrap replica fits (see "closure_replicas"):
+	if (params_replicas) {
+		shifte = params_replicas->GetBinError(2);
+		stretche = params_replicas->GetBinError(3);
+	}
 	
-	TH1F* h_null = (TH1F*) h_fjp->Clone(fullname);
-	differentiate_cdf(h_cdf, h_null, median_from_cdf(h_cdf), amp, shift, stretch);
-	h_null->Rebin(nrebin);
-	
-//	TH1F* h_amp_plus = (TH1F*) h_fjp->Clone(fullname + TString("__amp") + name + TString("__plus"));
-//	differentiate_cdf(h_cdf, h_amp_plus, median_from_cdf(h_cdf), amp + ampe, shift, stretch);
-//	h_amp_plus->Rebin(nrebin);
-//	TH1F* h_amp_minus = (TH1F*) h_fjp->Clone(fullname + TString("__amp") + name + TString("__minus"));
-//	differentiate_cdf(h_cdf, h_amp_minus, median_from_cdf(h_cdf), amp - ampe, shift, stretch);
-//	h_amp_minus->Rebin(nrebin);
-	TH1F* h_shift_plus = (TH1F*) h_fjp->Clone(fullname + TString("__shift") + name + TString("__plus"));
-	differentiate_cdf(h_cdf, h_shift_plus, median_from_cdf(h_cdf), amp, shift + shifte, stretch);
-	h_shift_plus->Rebin(nrebin);
-	TH1F* h_shift_minus = (TH1F*) h_fjp->Clone(fullname + TString("__shift") + name + TString("__minus"));
-	differentiate_cdf(h_cdf, h_shift_minus, median_from_cdf(h_cdf), amp, shift - shifte, stretch);
-	h_shift_minus->Rebin(nrebin);
-	TH1F* h_stretch_plus = (TH1F*) h_fjp->Clone(fullname + TString("__stretch") + name + TString("__plus"));
-	differentiate_cdf(h_cdf, h_stretch_plus, median_from_cdf(h_cdf), amp, shift, stretch + stretche);
-	h_stretch_plus->Rebin(nrebin);
-	TH1F* h_stretch_minus = (TH1F*) h_fjp->Clone(fullname + TString("__stretch") + name + TString("__minus"));
-	differentiate_cdf(h_cdf, h_stretch_minus, median_from_cdf(h_cdf), amp, shift, stretch - stretche);
-	h_stretch_minus->Rebin(nrebin);
+	// The nominal template and its variations, in the rebinned binning of h_fjp:
+	template_variations variations(h_cdf, h_fjp, nrebin, amp, shift, stretch);
+//	variations.add("amp", "amp" + name, ampe);
+	variations.add("shift", "shift" + name, shifte);
+	variations.add("stretch", "stretch" + name, stretche);
 	
 	params_out->SetBinContent(params_out_offset, amp);
 	params_out->SetBinError(params_out_offset, ampe);
@@ -107,15 +96,12 @@ void make_plots(TString name, TFile* tf_out, TH1* h_fjp, TH1* h_cdf, TH1* params
 	params_out->SetBinContent(params_out_offset + 2, stretch);
 	params_out->SetBinError(params_out_offset + 2, stretche);
 	
-	tf_out->WriteTObject(h_null);
-	tf_out->WriteTObject(h_shift_plus);
-	tf_out->WriteTObject(h_shift_minus);
-	tf_out->WriteTObject(h_stretch_plus);
-	tf_out->WriteTObject(h_stretch_minus);
+	variations.write(tf_out, fullname);
 }
 
 
-void theta_plotter(TString cut_sig="sig", TString cut_sb="sb", TString inj="") {
+void theta_plotter(TString cut_sig="sig", TString cut_sb="sb", TString inj="", TString replicas="") {
+	// "replicas" is an output of "closure_replicas" ("closure_plotter.cc"); without it, the QCD shift and stretch errors are the hand-set ones.
 	int nrebin = 50;
 	if (cut_sig == "sig") nrebin = 30;
 	
@@ -136,6 +122,12 @@ void theta_plotter(TString cut_sig="sig", TString cut_sb="sb", TString inj="") {
 	TH1* params_sbb = (TH1*) tf_sbb->Get("params");
 	params_sbb->SetName("params_sbb");
 	TH1D* params_out = new TH1D("params", "", 27, 0, 27);
+	TH1* params_replicas = 0;
+	if (replicas != "") {
+		TFile* tf_replicas = TFile::Open(replicas);
+		params_replicas = tf_replicas ? (TH1*) tf_replicas->Get("params_replicas") : 0;
+		if (!params_replicas) cout << "[!!] ERROR: " << replicas << " has no \"params_replicas\", so the hand-set QCD errors are used." << endl;
+	}
 	
 	// Data:
 	TH1F* h_data_original = (TH1F*) tf_sig->Get("fjp_jetht");
@@ -153,7 +145,9 @@ void theta_plotter(TString cut_sig="sig", TString cut_sb="sb", TString inj="") {
 		1,
 		nrebin,
 		params_out,
-		1
+		1,
+		false,
+		params_replicas
 	);
 	// TTbar:
 	make_plots(
@@ -2,6 +2,7 @@
 #include <sstream>
 #include <string>
 #include <Deracination/Straphanger/test/decortication/macros/common.cc>
+#include <Analyzers/FatjetAnalyzer/test/analysis/template_variations.cc>
 
 bool VERBOSE = true;
 
@@ -19,34 +20,15 @@ void make_plots(TString region, TString name, TFile* tf_out, TH1* h_fjp, TH1* h_
 	stretche = 0.5;
 	shifte = 100;
 	
-	TH1F* h_null = (TH1F*) h_fjp->Clone(fullname);
-	differentiate_cdf(h_cdf, h_null, median_from_cdf(h_cdf), amp, shift, stretch);
-	h_null->Rebin(nrebin);
-	
-	// Shift:
+	// The nominal template and its variations, in the rebinned binning of h_fjp:
+	template_variations variations(h_cdf, h_fjp, nrebin, amp, shift, stretch);
 	TString parname = "shift" + name;
 //	if (name == "QCD") parname += region;
-	TH1F* h_shift_plus = (TH1F*) h_fjp->Clone(fullname + "__" + parname + "__plus");
-	differentiate_cdf(h_cdf, h_shift_plus, median_from_cdf(h_cdf), amp, shift + shifte, stretch);
-	h_shift_plus->Rebin(nrebin);
-	TH1F* h_shift_minus = (TH1F*) h_fjp->Clone(fullname + "__" + parname + "__minus");
-	differentiate_cdf(h_cdf, h_shift_minus, median_from_cdf(h_cdf), amp, shift - shifte, stretch);
-	h_shift_minus->Rebin(nrebin);
-	
-	// Stretch:
+	variations.add("shift", parname, shifte);
 	parname = "stretch" + name;
-	TH1F* h_stretch_plus = (TH1F*) h_fjp->Clone(fullname + "__" + parname + "__plus");
-	differentiate_cdf(h_cdf, h_stretch_plus, median_from_cdf(h_cdf), amp, shift, stretch + stretche);
-	h_stretch_plus->Rebin(nrebin);
-	TH1F* h_stretch_minus = (TH1F*) h_fjp->Clone(fullname + "__" + parname + "__minus");
-	differentiate_cdf(h_cdf, h_stretch_minus, median_from_cdf(h_cdf), amp, shift, stretch - stretche);
-	h_stretch_minus->Rebin(nrebin);
+	variations.add("stretch", parname, stretche);
 	
-	tf_out->WriteTObject(h_null);
-	tf_out->WriteTObject(h_shift_plus);
-	tf_out->WriteTObject(h_shift_minus);
-	tf_out->WriteTObject(h_stretch_plus);
-	tf_out->WriteTObject(h_stretch_minus);
+	variations.write(tf_out, fullname);
 }
 
 
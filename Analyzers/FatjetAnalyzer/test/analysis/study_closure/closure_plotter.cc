@@ -1,4 +1,6 @@
 #include "/home/tote/decortication/macros/common.cc"
+#include <Analyzers/FatjetAnalyzer/test/analysis/histogram_cache.cc>
+#include <Analyzers/FatjetAnalyzer/test/analysis/cdf_fitter.cc>
 
 void draw_plot(TString name, TString ds, TString cut, TH1* data, TH1* temp, TH1* fit, TH1* params, vector<Double_t> stats, int logy=0) {
 	// Make pull:
@@ -68,73 +70,32 @@ void draw_plot(TString name, TString ds, TString cut, TH1* data, TH1* temp, TH1*
 	tc->SaveAs(name + ".png");
 }
 
-void closure_plotter(TString cut_name="sb", TString ds="qcdmg", int nrebin=30, bool ht=true, TString dir="", int f=1) {
-//	TFile* tf_in = TFile::Open("~/anatuples/anatuple_dalitz_predeta.root");
-	TFile* tf_in = get_ana();
-	
-	TTree *tt = (TTree*) tf_in->Get(ds);
-	
-	tt->Draw("mavg_p>>" + ds + "_fjp(1200,0,1200)", get_cut("fjp_" + cut_name, get_weight(ds)));
-	TH1 *h_fjp = (TH1*) gDirectory->Get(ds + "_fjp");
-	TH1* h_temp = fetch_template(ds, cut_name, dir, f, ht);
-	TH1 *h_cdf = make_cdf(h_temp, ds + "_cdf");
-	
-	/// Save untouched plots for use later:
-	TH1* h_fjp_original = (TH1*) h_fjp->Clone("fjp");
-	
-	/// best guesses for the amplitude, shift, and stretch:
-	double amp = h_fjp->Integral(1, h_fjp->GetNbinsX())/h_temp->Integral(1, h_temp->GetNbinsX());
-	double shift = 0.0;
-	double stretch = 1.0;
-	double ampe, shifte, stretche;
+vector<double> get_closure_bins(TString ds, TString cut_name, bool ht=true) {
+	// The fit binning:
 	vector<double> bins {0, 100, 150, 200, 250, 300, 350, 400, 500, 600, 650, 800};
 	if (ds == "jetht" && cut_name == "sb") {
-		amp = 2e-6;
-		shift = -10;
-		stretch = 0.90;
 		bins = {0, 50, 150, 200, 250, 300, 400, 500, 600};
 	}
 	else if (ds == "qcdmg" && cut_name == "sb") {
-		amp = 2e-6;
-		shift = -10;
-		stretch = 0.90;
 		bins = {0, 100, 150, 200, 250, 300, 350, 400, 500, 600, 650};
 	}
 	else if (ds == "qcdp" && cut_name == "sb") {
-		amp = 1e-6;
-		shift = -20;
-		stretch = 0.90;
 //		bins = {0, 50, 100, 150, 200, 250, 300, 350, 400, 450, 500, 600, 800};
 		bins = {0, 100, 150, 200, 250, 300, 350, 400, 500, 600};
 	}
 	else if (ds == "qcdmg" && cut_name == "sbb") {
-		amp = 5.0e-7;
-		shift = -10;
-		stretch = 0.95;
 		bins = {0, 50, 100, 150, 200, 250, 300, 400, 500};
 	}
 	else if (ds == "qcdp" && cut_name == "sbb") {
-		amp = 5.0e-6;
-		shift = -10;
-		stretch = 0.95;
 		bins = {0, 50, 100, 150, 200, 250, 300, 400, 500};
 	}
 	else if (ds == "qcdmg" && cut_name == "sig") {
-		amp = 2.0e-6;
-		shift = 1.0;
-		stretch = 1.0;
 		bins = {50, 100, 150, 200, 250, 300, 400, 500, 600, 800};
 	}
 	else if (ds == "qcdp" && cut_name == "sig") {
-		amp = 2.0e-7;
-		shift = 0.0;
-		stretch = 1.0;
 		bins = {90, 120, 150, 180, 210, 270, 330, 390, 450, 510, 570, 630};
 	}
 	else if (ds == "qcdmg" && cut_name == "sigl" && ht) {		// This works
-		amp = 2.0e-6;
-		shift = 1.0;
-		stretch = 1.0;
 		bins = {50, 100, 150, 250, 300, 350, 400, 450, 500, 550, 600, 800};
 	}
 //	else if (ds == "qcdmg" && cut_name == "sigl" && ht) {		// Experimental
@@ -144,64 +105,47 @@ void closure_plotter(TString cut_name="sb", TString ds="qcdmg", int nrebin=30, b
 //		bins = {100, 250, 350, 550, 800};
 //	}
 	else if (ds == "qcdmg" && cut_name == "sigl" && !ht) {
-		amp = 2.0e-6;
-		shift = 1.0;
-		stretch = 1.0;
 		bins = {0, 50, 100, 150, 200, 250, 300, 400};
 	}
 	else if (ds == "qcdp" && cut_name == "sigl" && ht) {
-		amp = 4.0e-7;
-		shift = -10.0;
-		stretch = 1.0;
 		bins = {0, 200, 300, 400, 500, 600, 700, 800, 900, 1100};
 	}
 	else if (cut_name == "sbt") {
-		amp = 2e-6;
-		shift = -10;
-		stretch = 0.90;
 		bins = {0, 100, 150, 200, 250, 300, 350, 400, 500, 600, 650};
 	}
 	else if (cut_name == "sbtb") {
-		amp = 5.0e-6;
-		shift = -10;
-		stretch = 0.95;
 		bins = {0, 100, 150, 200, 300, 450};
 	}
 	else if (cut_name == "sbs") {
-		amp = 2e-6;
-		shift = -10;
-		stretch = 0.90;
 		bins = {0, 50, 100, 150, 200, 250, 300, 350, 400, 450, 500, 550, 600, 650};
 	}
 	else if (cut_name == "sbsb") {
-		amp = 5.0e-6;
-		shift = -10;
-		stretch = 0.95;
 		bins = {0, 100, 150, 200, 250, 300, 400};
 	}
 	else if (cut_name == "sigs") {
-		amp = 2.0e-6;
-		shift = 1.0;
-		stretch = 1.0;
 		bins = {0, 100, 150, 200, 250, 300, 400, 500, 600};
 	}
+	return bins;
+}
+
+cdf_fitter* prepare_closure_fit(TFile* tf_in, TString cut_name, TString ds, bool ht, TString dir, int f, TH1*& h_fjp, TH1*& h_temp) {
+	TTree *tt = (TTree*) tf_in->Get(ds);
 	
-	TH1* params = new TH1D("params", "", 3, 0, 3);
-	params->SetBinContent(1, amp);
-	params->SetBinError(1, ampe);
-	params->SetBinContent(2, shift);
-	params->SetBinError(2, shifte);
-	params->SetBinContent(3, stretch);
-	params->SetBinError(3, stretche);
-	
-	/// Fit:
-	perform_fit(h_fjp, h_cdf, bins, params);
+	h_fjp = cached_draw(tt, ds + "_fjp", "mavg_p", get_cut("fjp_" + cut_name, get_weight(ds)), 1200, 0, 1200);
+	h_temp = fetch_template(ds, cut_name, dir, f, ht);
 	
-	print_params(params);
+	/// (The shift, stretch, and amplitude need no starting values: "cdf_fitter" scans for them.)
+	cdf_fitter* fit = new cdf_fitter(h_fjp, get_closure_bins(ds, cut_name, ht), ds + "_" + cut_name);
+	fit->add_template(h_temp);
+	return fit;
+}
+
+void draw_closure(TString cut_name, TString ds, int nrebin, bool ht, TString dir, int f, TH1* h_fjp, TH1* h_temp, cdf_fitter* fit) {
+	TH1* params = fit->get_params();
 	
-	/// Make a new template from the CDF using the fitted values
+	/// Make a new template using the fitted values:
 	TH1* h_fit = (TH1*) h_temp->Clone(ds + "_fit");
-	differentiate_cdf(h_cdf, h_fit, median_from_cdf(h_cdf), params->GetBinContent(1), params->GetBinContent(2), params->GetBinContent(3));
+	fit->fill(h_fit);
 	
 	// Normalize unfitted stuff: (Don't normalize it before fitting!)
 	h_temp->Scale(h_fjp->Integral(1, h_fjp->GetNbinsX())/h_temp->Integral(1, h_temp->GetNbinsX()));
@@ -243,11 +187,93 @@ void closure_plotter(TString cut_name="sb", TString ds="qcdmg", int nrebin=30, b
 }
 
 
+void closure_plotter(TString cut_name="sb", TString ds="qcdmg", int nrebin=30, bool ht=true, TString dir="", int f=1) {
+//	TFile* tf_in = TFile::Open("~/anatuples/anatuple_dalitz_predeta.root");
+	TFile* tf_in = get_ana();
+	TH1 *h_fjp, *h_temp;
+	cdf_fitter* fit = prepare_closure_fit(tf_in, cut_name, ds, ht, dir, f, h_fjp, h_temp);
+	
+	/// Fit:
+	fit->fit();
+	fit->print();
+	
+	draw_closure(cut_name, ds, nrebin, ht, dir, f, h_fjp, h_temp, fit);
+}
 
+void closure_plotter_all(TString cut_names="sb,sbb,sig", TString dss="qcdmg,qcdp", int nrebin=30, bool ht=true, TString dir="", int f=1) {
+	// Make the closure plots of several datasets and cuts, with the fits run in parallel:
+	TFile* tf_in = get_ana();
+	vector<TString> cuts_list, dss_list;
+	TObjArray* tokens = cut_names.Tokenize(",");
+	for (int i = 0; i < tokens->GetEntries(); ++i) cuts_list.push_back(((TObjString*) tokens->At(i))->GetString());
+	tokens = dss.Tokenize(",");
+	for (int i = 0; i < tokens->GetEntries(); ++i) dss_list.push_back(((TObjString*) tokens->At(i))->GetString());
+	
+	vector<cdf_fitter*> fits;
+	vector<TH1*> h_fjps, h_temps;
+	for (auto& cut_name : cuts_list) {
+		for (auto& ds : dss_list) {
+			TH1 *h_fjp, *h_temp;
+			fits.push_back(prepare_closure_fit(tf_in, cut_name, ds, ht, dir, f, h_fjp, h_temp));
+			h_fjps.push_back(h_fjp);
+			h_temps.push_back(h_temp);
+		}
+	}
+	fit_cdfs(fits);
+	
+	unsigned i = 0;
+	for (auto& cut_name : cuts_list) {
+		for (auto& ds : dss_list) {
+			draw_closure(cut_name, ds, nrebin, ht, dir, f, h_fjps[i], h_temps[i], fits[i]);
+			i++;
+		}
+	}
+}
 
-
-
-
-
-
-
+void closure_replicas(TString cut_name="sb", TString ds="qcdmg", int n_replicas=100, bool ht=true, int f=1) {
+	// Repeat the closure fit with each Poisson-bootstrap replica of the template (made with "template_plotter" and its
+	// "n_replicas"), and write the nominal fit parameters, with the spread of the replica fits as their errors, to
+	// "closure_replicas_<ds>_<cut>.root". "theta_plotter" can use these instead of its hand-set shift and stretch errors.
+	TFile* tf_in = get_ana();
+	TH1 *h_fjp, *h_temp;
+	vector<cdf_fitter*> fits = {prepare_closure_fit(tf_in, cut_name, ds, ht, "", f, h_fjp, h_temp)};
+	
+	TString temp_name = "temp_" + ds + "_" + cut_name + "_p_f" + to_string(f);
+	TString temps_name = "template_plots_" + cut_name;
+	if (!ht) {
+		temp_name += "_xht";
+		temps_name += "_xht";
+	}
+	TFile* tf_temps = TFile::Open(temps_name + ".root");
+	if (!tf_temps) {
+		cout << "[!!] ERROR: " << temps_name << ".root doesn't open." << endl;
+		return;
+	}
+	for (int k = 0; k < n_replicas; ++k) {
+		TH1* h_replica = (TH1*) tf_temps->Get(temp_name + "_r" + to_string(k));
+		if (!h_replica) {
+			cout << "[!!] ERROR: " << temps_name << ".root has no replica " << k << " (run \"template_plotter\" with n_replicas = " << n_replicas << ")." << endl;
+			return;
+		}
+		cdf_fitter* fit = new cdf_fitter(h_fjp, get_closure_bins(ds, cut_name, ht), ds + "_" + cut_name + "_r" + to_string(k));
+		fit->add_template(h_replica);
+		fits.push_back(fit);
+	}
+	fit_cdfs(fits);
+	
+	// The spread of each parameter over the replicas:
+	TH1* params = fits[0]->get_params("params_replicas");
+	for (unsigned i = 0; i < fits[0]->NDim(); ++i) {
+		double sum = 0, sum2 = 0;
+		for (int k = 1; k <= n_replicas; ++k) {
+			sum += fits[k]->p[i];
+			sum2 += fits[k]->p[i]*fits[k]->p[i];
+		}
+		double mean = sum/n_replicas;
+		params->SetBinError(i + 1, sqrt(max(sum2/n_replicas - mean*mean, 0.0)));
+	}
+	cout << "[OK] Over " << n_replicas << " replicas: shift = " << params->GetBinContent(2) << " +/- " << params->GetBinError(2) << ", stretch = " << params->GetBinContent(3) << " +/- " << params->GetBinError(3) << endl;
+	TFile* tf_out = new TFile("closure_replicas_" + ds + "_" + cut_name + ".root", "RECREATE");
+	tf_out->WriteTObject(params);
+	tf_out->Close();
+}
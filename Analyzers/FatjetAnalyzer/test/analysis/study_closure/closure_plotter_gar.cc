@@ -1,4 +1,5 @@
 #include <Deracination/Straphanger/test/decortication/macros/common.cc>
+#include <Analyzers/FatjetAnalyzer/test/analysis/garwood.cc>
 
 void fix_zeros(TH1* h) {
 	for (unsigned i = 0; i <= h->GetNbinsX(); ++i) {
@@ -88,7 +89,7 @@ void closure_plotter_gar(TString cut_name="sb", TString ds="qcdmg", int nrebin=3
 	
 //	tt->Draw("mavg_p>>" + ds + "_fjp(1200,0,1200)", get_cut("fjp_" + cut_name, get_weight(ds)));
 //	TH1 *h_fjp = (TH1*) gDirectory->Get(ds + "_fjp");
-	TH1D* h_fjp = make_qcd_garwood(tf_in, ds, cut_name, nrebin);
+	TH1D* h_fjp = fill_garwood(tt, "mavg_p", {cut_name}, {TString(get_cut("fjp_" + cut_name, get_weight(ds)))}, 1200, 0, 1200, nrebin)[0];
 	cout << "here" << endl;
 	TH1* h_temp = fetch_template(ds, cut_name, dir, f, ht);
 	TH1* h_cdf = make_cdf(h_temp, ds + "_cdf");
@@ -1,44 +1,35 @@
 #include <Deracination/Straphanger/test/decortication/macros/common.cc>
+#include <Analyzers/FatjetAnalyzer/test/analysis/garwood.cc>
 
 void garwood_plotter(int nrebin=30) {
 	// Run this code to produce mavg_p distributions for the QCD samples with Garwood interval error bars.
 	//
-	// This code takes a while to run because there is some nuance to calculating Garwood intervals for distributions
-	// that combine events with different weights.
+	// Each dataset is read once: every cut is filled in the same pass, along with the raw entries of each bin, and
+	// the intervals are made from the (rebinned) sums of weights, sums of squared weights, and entries (see "garwood.cc").
 	
 	gROOT->SetBatch();
 	
 	vector<TString> dss = {"qcdmg", "qcdp"};
 	vector<TString> cuts = {"sig", "sigl", "sb", "sbl"};
 	
-	for (int icut = 0; icut < cuts.size(); ++icut) {
-		TString cut = cuts[icut];
-//		TFile* tf_out = TFile::Open("garwood_plots_" + cut + ".root", "recreate");		// This isn't necessary; the function that makes the plot already saves it to a file.
-	
-		for (int ids = 0; ids < dss.size(); ++ids) {
-			TString ds = dss[ids];
-			TString ana_option = "";
-//			if (ds == "qcdp") ana_option = ds;
-			TFile* tf_in = get_ana(ana_option);
-			
-			// Make the plot:
-			cout << "[..] Making the Garwoodified plot for " << ds << " with cut " << cut << "." << endl;
-			TH1D* h = make_qcd_garwood(tf_in, ds, cut, nrebin);
-			
-			// Save the plot:
-			// Note: The plot is automatically saved by the make_qcd_garwood function.
-//			tf_out->WriteTObject(h);
+	for (int ids = 0; ids < dss.size(); ++ids) {
+		TString ds = dss[ids];
+		TString ana_option = "";
+//		if (ds == "qcdp") ana_option = ds;
+		TFile* tf_in = get_ana(ana_option);
+		TTree* tt = (TTree*) tf_in->Get(ds);
+		
+		// Make the plots:
+		cout << "[..] Making the Garwoodified plots for " << ds << "." << endl;
+		vector<TString> selections;
+		for (int icut = 0; icut < cuts.size(); ++icut) selections.push_back(TString(get_cut("fjp_" + cuts[icut], get_weight(ds))));
+		vector<TH1D*> hs = fill_garwood(tt, "mavg_p", cuts, selections, 1200, 0, 1200, nrebin);
+		
+		// Save the plots (one file per cut, which is what "closure_styler.cc" reads):
+		for (int icut = 0; icut < cuts.size(); ++icut) {
+			TFile* tf_out = TFile::Open("garwood_plots_" + ds + "_" + cuts[icut] + ".root", "recreate");
+			tf_out->WriteTObject(hs[icut], "gar");
+			tf_out->Close();
 		}
-//		tf_out->Close();
 	}
 }
-
-
-
-
-
-
-
-
-
-
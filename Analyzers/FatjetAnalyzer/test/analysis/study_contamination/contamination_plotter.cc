@@ -1,25 +1,23 @@
 #include <Deracination/Straphanger/test/decortication/macros/common.cc>
+#include <Analyzers/FatjetAnalyzer/test/analysis/histogram_cache.cc>
 
-vector<TH1*> make_plot_set(TString cut, int nbins=1200) {
+vector<int> request_plot_set(histogram_cache& cache, TString cut, int nbins=1200) {
 //	vector<TString> names = {"jetht", "qcdmg", "qcdp", "ttbar"};
 //	vector<TString> names_sq = {"sq100to4j", "sq150to4j", "sq175to4j", "sq200to4j", "sq250to4j", "sq300to4j", "sq400to4j", "sq500to4j", "sq600to4j", "sq700to4j"};
 //	vector<TString> names_sg = {"sg100to5j", "sg150to5j", "sg175to5j", "sg200to5j", "sg250to5j", "sg300to5j", "sg350to5j", "sg400to5j", "sg450to5j", "sg500to5j", "sg550to5j", "sg600to5j", "sg650to5j"};
 	
 	TFile* tf_in = get_ana();
 	vector<TString> names = list_tfile(tf_in);
-	vector<TH1*> plots;
+	vector<int> plots;
 	
-	cout << "[..] Making plots for the " << cut << " cut." << endl;
+	cout << "[..] Requesting plots for the " << cut << " cut." << endl;
 	
 	for (int i = 0; i < names.size(); ++ i) {
 		TString name = names[i] + "_" + cut;
 		TTree* tt = (TTree*) tf_in->Get(names[i]);
 		TString cut_option = "";
 		if (names[i] == "ttbar") cut_option = "wtt";
-		tt->Draw("mavg_p>>" + name + "(" + to_string(nbins) + ", 0, 1200)", get_cut("fjp_" + cut, cut_option));
-		TH1* h = (TH1*) gDirectory->Get(name);
-		h->SetTitle("");
-		plots.push_back(h);
+		plots.push_back(cache.request(tt, name, "mavg_p", get_cut("fjp_" + cut, cut_option), nbins, 0, 1200));
 	}
 //	// Special treatment for signals:
 ////	cout << "sq" << endl;
@@ -60,10 +58,15 @@ void contamination_plotter(TString option="") {
 	TFile* tf_out = new TFile(output_name + "_plots.root", "RECREATE");
 	
 	// Loop over cuts:
+	/// (Plots that are already in "histogram_cache.root" aren't remade, and the rest are made from one loop over each tree.)
+	histogram_cache cache;
+	vector<int> plots;
 	for (int i = 0; i < cuts.size(); ++ i) {
-		vector<TH1*> plots = make_plot_set(cuts[i]);
-		
-		// Write out plots:
-		for (int j = 0; j < plots.size(); ++ j) {tf_out->WriteTObject(plots[j]);}
+		vector<int> plots_cut = request_plot_set(cache, cuts[i]);
+		plots.insert(plots.end(), plots_cut.begin(), plots_cut.end());
 	}
+	cache.fill();
+	
+	// Write out plots:
+	for (int j = 0; j < plots.size(); ++ j) {tf_out->WriteTObject(cache.at(plots[j]));}
 }
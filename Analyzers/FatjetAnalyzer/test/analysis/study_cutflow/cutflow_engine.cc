@@ -0,0 +1,142 @@
+// cutflow_engine: makes the cutflow histograms of many trees, one pass over
+// each tree, with the trees read in parallel.
+//
+// The cut steps are cumulative: an event passes step i if it passes the cuts
+// of steps 0 to i. Each step's cut is evaluated once per event into a bit of a
+// mask, and evaluation stops at the first step that fails. For each tree and
+// each step, the engine counts the raw entries, the sum of weights, and the
+// sum of squared weights, and writes
+//     "<tree>_<name>_n": raw entries
+//     "<tree>_<name>_w": sum of weights (with errors from the sum of squared weights)
+//     "<tree>_<name>_w2": sum of squared weights
+//     "<tree>_<name>_p": the sum of weights relative to the first step, in percent
+// which is what "cutflow_tabler.py" reads. It's run by "cutflow_plotter.py".
+// The input can be several anatuples (a ","-separated list, like
+// "anatuple.root,anatuple_wz.root"): each tree is read from the first one that
+// has it.
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+#include "TH1D.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TROOT.h"
+#include "TStopwatch.h"
+
+using namespace std;
+
+struct cutflow_result {
+	TString tree, weight;
+	vector<double> n, w, w2;
+	bool ok;
+};
+
+vector<TString> split_list(TString list, TString delimiter) {
+	vector<TString> result;
+	TObjArray* tokens = list.Tokenize(delimiter);
+	for (int i = 0; i < tokens->GetEntries(); ++i) result.push_back(((TObjString*) tokens->At(i))->GetString());
+	delete tokens;
+	return result;
+}
+
+void run_cutflow(const vector<TString>& files, const vector<TString>& cuts, cutflow_result& result) {
+	// Each tree gets its own file handle, so this can run in a thread:
+	result.n.assign(cuts.size(), 0);
+	result.w.assign(cuts.size(), 0);
+	result.w2.assign(cuts.size(), 0);
+	TFile* tf_in = 0;
+	TTree* tt = 0;
+	for (unsigned i = 0; i < files.size() && !tt; ++i) {
+		tf_in = TFile::Open(files[i]);
+		tt = tf_in ? (TTree*) tf_in->Get(result.tree) : 0;
+		if (!tt && tf_in) tf_in->Close();
+	}
+	result.ok = tt != 0;
+	if (!tt) return;
+	vector<TTreeFormula*> f_cuts;
+	for (unsigned i = 0; i < cuts.size(); ++i) f_cuts.push_back(new TTreeFormula(TString::Format("cut%d", i), cuts[i], tt));
+	TTreeFormula* f_w = new TTreeFormula("weight", result.weight, tt);
+
+	Long64_t n = tt->GetEntries();
+	for (Long64_t ientry = 0; ientry < n; ++ientry) {
+		tt->LoadTree(ientry);		// The formulas read only the branches that they need.
+		unsigned mask = 0;
+		for (unsigned i = 0; i < f_cuts.size(); ++i) {
+			// An entry passes a cut if any instance passes (the same as "TTree::Draw"):
+			bool pass = false;
+			int ndata = f_cuts[i]->GetNdata();
+			for (int k = 0; k < ndata && !pass; ++k) pass = f_cuts[i]->EvalInstance(k) != 0;
+			if (!pass) break;
+			mask |= 1u << i;
+		}
+		if (!mask) continue;
+		double w = f_w->GetNdata() ? f_w->EvalInstance() : 0;
+		for (unsigned i = 0; i < f_cuts.size() && (mask >> i & 1); ++i) {
+			result.n[i] += 1;
+			result.w[i] += w;
+			result.w2[i] += w*w;
+		}
+	}
+	for (auto f : f_cuts) delete f;
+	delete f_w;
+	tf_in->Close();
+}
+
+void cutflow_engine(TString f_in, TString name, TString cuts_list, TString trees_list, TString weights_list, TString f_out="cutflow_plots.root", int n_threads=0) {
+	// "f_in" is a ","-separated list of anatuples, "cuts_list" a ";"-separated list of the step cuts, "trees_list" a ","-separated list of trees, and "weights_list" their weights (in the same order):
+	TStopwatch timer;
+	vector<TString> files = split_list(f_in, ",");
+	vector<TString> cuts = split_list(cuts_list, ";");
+	vector<TString> trees = split_list(trees_list, ",");
+	vector<TString> weights = split_list(weights_list, ",");
+	if (cuts.empty() || cuts.size() > 32) {
+		cout << "[!!] ERROR: A cutflow needs between 1 and 32 steps." << endl;
+		return;
+	}
+	vector<cutflow_result> results;
+	for (unsigned i = 0; i < trees.size(); ++i) results.push_back({trees[i], i < weights.size() ? weights[i] : TString("w"), {}, {}, {}, false});
+
+	// Run the trees in parallel:
+	ROOT::EnableThreadSafety();
+	if (n_threads <= 0) n_threads = max(1u, thread::hardware_concurrency());
+	atomic<unsigned> next(0);
+	vector<thread> threads;
+	for (int t = 0; t < min<int>(n_threads, results.size()); ++t) {
+		threads.push_back(thread([&]() {
+			for (unsigned i = next++; i < results.size(); i = next++) run_cutflow(files, cuts, results[i]);
+		}));
+	}
+	for (auto& t : threads) t.join();
+
+	// Write out the histograms:
+	TFile* tf_out = TFile::Open(f_out, "UPDATE");
+	for (auto& result : results) {
+		if (!result.ok) {
+			cout << "[!!] WARNING: " << result.tree << " isn't in " << f_in << ", so it has no cutflow." << endl;
+			continue;
+		}
+		TString prefix = result.tree + "_" + name + "_";
+		TH1D* h_n = new TH1D(prefix + "n", "", cuts.size(), 0, cuts.size());
+		TH1D* h_w = new TH1D(prefix + "w", "", cuts.size(), 0, cuts.size());
+		TH1D* h_w2 = new TH1D(prefix + "w2", "", cuts.size(), 0, cuts.size());
+		TH1D* h_p = new TH1D(prefix + "p", "", cuts.size(), 0, cuts.size());
+		for (unsigned i = 0; i < cuts.size(); ++i) {
+			h_n->SetBinContent(i + 1, result.n[i]);
+			h_w->SetBinContent(i + 1, result.w[i]);
+			h_w->SetBinError(i + 1, sqrt(result.w2[i]));
+			h_w2->SetBinContent(i + 1, result.w2[i]);
+			h_p->SetBinContent(i + 1, result.w[0] != 0 ? result.w[i]/result.w[0]*100 : 0);
+		}
+		for (TH1D* h : {h_n, h_w, h_w2, h_p}) tf_out->WriteTObject(h, h->GetName(), "Overwrite");
+		cout << "\t" << result.tree << ": " << result.n.back() << "/" << result.n.front() << " entries" << endl;
+	}
+	tf_out->Close();
+	cout << "[OK] Wrote the " << name << " cutflows to " << f_out << " in " << timer.RealTime() << " s." << endl;
+}
@@ -0,0 +1,65 @@
+####################################################################
+# Type: SCRIPT                                                     #
+#                                                                  #
+# Description: "python cutflow_plotter.py anatuple.root [sig ...]" #
+#   makes "cutflow_plots.root" (for "cutflow_tabler.py") from the  #
+#   cut steps in "cutflow.yaml", reading each tree once and the    #
+#   trees in parallel. Several anatuples can be given as a ","-    #
+#   separated list (like "anatuple.root,anatuple_wz.root" for the  #
+#   W and Z trees); each tree is read from the first that has it.  #
+####################################################################
+
+# IMPORTS:
+import sys, os
+import yaml
+from ROOT import gROOT
+from cutflow_tabler import get_ttnames
+# :IMPORTS
+
+# CLASSES:
+# :CLASSES
+
+# VARIABLES:
+n_threads = 0		# 0: one per core
+# :VARIABLES
+
+# FUNCTIONS:
+def get_cutflows(path="cutflow.yaml"):
+	with open(path) as f:
+		info = yaml.load(f)
+	weights = info.pop("weights", {})
+	return info, weights
+
+
+def get_cutnames(path="cutflow.yaml"):
+	cutflows, weights = get_cutflows(path)
+	return {name: [step["label"] for step in steps] for name, steps in cutflows.items()}
+
+
+def main():
+	# Arguments:
+	assert len(sys.argv) > 1
+	f_in = sys.argv[1]
+	cutflows, weights = get_cutflows()
+	names = [name for name in sys.argv[2:] if name in cutflows]
+	if not names: names = cutflows.keys()
+	tt_names = get_ttnames()
+	tt_names = tt_names["sq"] + tt_names["sg"] + tt_names["bkg"]
+	
+	# Make the cutflows:
+	gROOT.SetBatch()
+	gROOT.ProcessLine(".L cutflow_engine.cc+")
+	from ROOT import cutflow_engine
+	if os.path.exists("cutflow_plots.root"): os.remove("cutflow_plots.root")
+	for name in names:
+		print "[..] Making the {} cutflow for {} trees.".format(name, len(tt_names))
+		cuts = ";".join(step["cut"] for step in cutflows[name])
+		tt_weights = ",".join(weights.get(tt_name, weights.get("default", "w")) for tt_name in tt_names)
+		cutflow_engine(f_in, name, cuts, ",".join(tt_names), tt_weights, "cutflow_plots.root", n_threads)
+	return True
+# :FUNCTIONS
+
+# MAIN:
+if __name__ == "__main__":
+	main()
+# :MAIN
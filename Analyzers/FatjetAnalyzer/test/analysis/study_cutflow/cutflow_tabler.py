@@ -11,7 +11,6 @@ from collections import OrderedDict
 from decortication.samples import names_latex
 from truculence import root
 from ROOT import TFile, TCut, TH1F, gROOT
-import cutflow
 # /IMPORTS
 
 # CLASSES:
@@ -32,17 +31,22 @@ def get_ttnames():
 def read_cutflow(name):
 	rf = root.rfile("cutflow_plots.root")
 #	ttrees = rf.get_ttrees()
-	info = cutflow.get_cutnames(style="latex")
+	from cutflow_plotter import get_cutnames
+	info = get_cutnames()
 	tt_names = get_ttnames()
 	tt_names = tt_names["sq"] + tt_names["sg"] + tt_names["bkg"]
 	results = OrderedDict()
 	for tt_name in tt_names:
 		print tt_name
+		h_names = {version: "{}_{}_{}".format(tt_name, name, version) for version in ["n", "w", "p"]}
+		if not all(rf.tf.GetKey(h_name) for h_name in h_names.values()):
+			print "[!!] WARNING: There's no {} cutflow for {} (it wasn't in the anatuples given to \"cutflow_plotter.py\"), so it's left out.".format(name, tt_name)
+			continue
 		results[tt_name] = []
 		for icut, cut in enumerate(info[name]):
 			cut_info = {"label": cut}
 			for version in ["n", "w", "p"]:
-				h = rf.tf.Get("{}_{}_{}".format(tt_name, name, version))
+				h = rf.tf.Get(h_names[version])
 				value = h.GetBinContent(icut + 1)
 				if version == "n": value = int(value)
 				cut_info[version] = value
@@ -59,7 +63,7 @@ def make_table(results, name, caption="", norm_qcd=True):
 	if not os.path.exists(path): os.makedirs(path)
 	
 	tt_names = get_ttnames()
-	cuts = [d["label"] for d in results[tt_names["sq"][0]]]
+	cuts = [d["label"] for d in results.values()[0]]
 	
 	table_name = "table_cutflow_{}".format(name)
 	tabular_name = "tabular_cutflow_{}".format(name)
@@ -86,6 +90,7 @@ def make_table(results, name, caption="", norm_qcd=True):
 	groups = ["sq", "sg", "bkg"]
 	for igroup, group in enumerate(groups):
 		for tt_name in tt_names[group]:
+			if tt_name not in results: continue
 			row = names_latex[tt_name] + " & "
 			norm_w = results[tt_name][1]["w"]
 			for icut, values_dict in enumerate(results[tt_name]):
@@ -125,6 +130,9 @@ def make_table(results, name, caption="", norm_qcd=True):
 
 def main():
 	results = read_cutflow("sig")
+	if not results:
+		print "[!!] ERROR: cutflow_plots.root has no sig cutflows."
+		return False
 	table = make_table(results, "sig", caption="The MC sample cutflow for the signal region. Percentages after the generator-level cut refer to the cumulative acceptance with respect to pre-selection.")
 	print table + "\n"
 # /FUNCTIONS
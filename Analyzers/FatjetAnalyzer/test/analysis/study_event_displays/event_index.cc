@@ -0,0 +1,168 @@
+// event_index: maps (run, lumi, event) to the MiniAOD file that the event is
+// in, so events can be picked straight from their files instead of searching
+// whole datasets with "edmPickEvents.py".
+//
+// The tuplizer writes the "file_id" of each event's MiniAOD file, and one entry
+// per input file to the "tuplizer/files" tree ("file_id", "file"). The index is
+// built once from a set of tuples with
+//     build_event_index("/path/to/tuples/*.root", "event_index.root")
+// which reads only the "run", "lumi", "event", and "file_id" branches, and
+// writes the records sorted by (run, lumi, event):
+//     "index": "run", "lumi", "event", "ifile" (an entry of "files")
+//     "files": "file", the LFN of each MiniAOD file
+// Loading it is one read of four branches, and each lookup is a binary search:
+//     event_index index("event_index.root");
+//     TString lfn = index.find(run, lumi, event);     // "" if it's not indexed
+// It's used by "pick_events.py".
+
+#ifndef EVENT_INDEX
+#define EVENT_INDEX
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <tuple>
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TChain.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TStopwatch.h"
+
+using namespace std;
+
+struct event_record {
+	UInt_t run, lumi;
+	ULong64_t event;
+	UInt_t ifile;
+
+	bool operator<(const event_record& other) const {
+		return tie(run, lumi, event) < tie(other.run, other.lumi, other.event);
+	}
+};
+
+void build_event_index(TString tuples, TString f_out="event_index.root") {
+	// "tuples" is a ","-separated list of tuple files (wildcards are allowed, like in "TChain::Add"):
+	TStopwatch timer;
+	TChain* tc_events = new TChain("tuplizer/events");
+	TChain* tc_files = new TChain("tuplizer/files");
+	TObjArray* tokens = tuples.Tokenize(",");
+	for (int i = 0; i < tokens->GetEntries(); ++i) {
+		TString path = ((TObjString*) tokens->At(i))->GetString();
+		tc_events->Add(path);
+		tc_files->Add(path);
+	}
+	delete tokens;
+
+	// The input files:
+	vector<string> files;
+	unordered_map<ULong64_t, UInt_t> ifiles;		// "file_id" -> entry of "files"
+	double file_id;
+	string* file = 0;
+	tc_files->SetBranchAddress("file_id", &file_id);
+	tc_files->SetBranchAddress("file", &file);
+	for (Long64_t i = 0; i < tc_files->GetEntries(); ++i) {
+		tc_files->GetEntry(i);
+		if (ifiles.insert({(ULong64_t) file_id, files.size()}).second) files.push_back(*file);
+	}
+	if (files.empty()) {
+		cout << "[!!] ERROR: There's no \"tuplizer/files\" tree in " << tuples << ". The tuples need to be made with a tuplizer that writes it." << endl;
+		return;
+	}
+
+	// The events (read only the four branches):
+	vector<event_record> records;
+	vector<double> *run = 0, *lumi = 0, *event = 0, *file_ids = 0;
+	tc_events->SetBranchStatus("*", 0);
+	for (TString name : {"run", "lumi", "event", "file_id"}) tc_events->SetBranchStatus(name, 1);
+	tc_events->SetBranchAddress("run", &run);
+	tc_events->SetBranchAddress("lumi", &lumi);
+	tc_events->SetBranchAddress("event", &event);
+	tc_events->SetBranchAddress("file_id", &file_ids);
+	Long64_t n = tc_events->GetEntries(), n_unknown = 0;
+	records.reserve(n);
+	for (Long64_t i = 0; i < n; ++i) {
+		tc_events->GetEntry(i);
+		if (run->empty() || file_ids->empty()) continue;
+		auto it = ifiles.find((ULong64_t) (*file_ids)[0]);
+		if (it == ifiles.end()) {
+			n_unknown++;
+			continue;
+		}
+		records.push_back({(UInt_t) (*run)[0], (UInt_t) (*lumi)[0], (ULong64_t) (*event)[0], it->second});
+	}
+	if (n_unknown) cout << "[!!] WARNING: " << n_unknown << " events came from files that aren't in \"tuplizer/files\", so they weren't indexed." << endl;
+	sort(records.begin(), records.end());
+
+	// Write the index:
+	TFile* tf_out = TFile::Open(f_out, "RECREATE");
+	TTree* tt_index = new TTree("index", "");
+	event_record record;
+	tt_index->Branch("run", &record.run, "run/i");
+	tt_index->Branch("lumi", &record.lumi, "lumi/i");
+	tt_index->Branch("event", &record.event, "event/l");
+	tt_index->Branch("ifile", &record.ifile, "ifile/i");
+	for (auto& r : records) {
+		record = r;
+		tt_index->Fill();
+	}
+	TTree* tt_files = new TTree("files", "");
+	string file_out;
+	tt_files->Branch("file", &file_out);
+	for (auto& f : files) {
+		file_out = f;
+		tt_files->Fill();
+	}
+	tf_out->Write();
+	tf_out->Close();
+	cout << "[OK] Indexed " << records.size() << " events in " << files.size() << " MiniAOD files to " << f_out << " in " << timer.RealTime() << " s." << endl;
+	delete tc_events;
+	delete tc_files;
+}
+
+class event_index {
+	public:
+		vector<event_record> records;       // Sorted by (run, lumi, event)
+		vector<string> files;
+
+		event_index(TString f_in="event_index.root") {
+			TFile* tf_in = TFile::Open(f_in);
+			TTree* tt_index = tf_in ? (TTree*) tf_in->Get("index") : 0;
+			TTree* tt_files = tf_in ? (TTree*) tf_in->Get("files") : 0;
+			if (!tt_index || !tt_files) {
+				cout << "[!!] ERROR: " << f_in << " isn't an event index (see \"build_event_index\")." << endl;
+				if (tf_in) tf_in->Close();
+				return;
+			}
+			event_record record;
+			tt_index->SetBranchAddress("run", &record.run);
+			tt_index->SetBranchAddress("lumi", &record.lumi);
+			tt_index->SetBranchAddress("event", &record.event);
+			tt_index->SetBranchAddress("ifile", &record.ifile);
+			records.reserve(tt_index->GetEntries());
+			for (Long64_t i = 0; i < tt_index->GetEntries(); ++i) {
+				tt_index->GetEntry(i);
+				records.push_back(record);
+			}
+			string* file = 0;
+			tt_files->SetBranchAddress("file", &file);
+			for (Long64_t i = 0; i < tt_files->GetEntries(); ++i) {
+				tt_files->GetEntry(i);
+				files.push_back(*file);
+			}
+			tf_in->Close();
+		}
+
+		TString find(UInt_t run, UInt_t lumi, ULong64_t event) const {
+			// The LFN of the MiniAOD file with the event, or "" if it's not in the index:
+			event_record key = {run, lumi, event, 0};
+			auto it = lower_bound(records.begin(), records.end(), key);
+			if (it == records.end() || key < *it) return "";
+			return files[it->ifile].c_str();
+		}
+};
+
+#endif
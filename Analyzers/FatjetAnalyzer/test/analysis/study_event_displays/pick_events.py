@@ -0,0 +1,87 @@
+####################################################################
+# Type: SCRIPT                                                     #
+#                                                                  #
+# Description: "python pick_events.py [events.txt] [index]" picks  #
+#   the events in "events.txt" ("run:lumi:event" lines, from       #
+#   "event_list_formatter.py") straight from their MiniAOD files,  #
+#   which it finds in the event index ("event_index.cc"). It       #
+#   writes "pick_events_cfg.py", a cmsRun configuration that reads #
+#   only those files with an "eventsToProcess" list, and runs it.  #
+#   Events that aren't in the index are written to                 #
+#   "events_missing.txt" for "pick_events.sh".                     #
+####################################################################
+
+# IMPORTS:
+import sys, os
+from collections import OrderedDict
+from ROOT import gROOT
+# :IMPORTS
+
+# CLASSES:
+# :CLASSES
+
+# VARIABLES:
+f_events = "events.txt"
+f_index = "event_index.root"		# Made with "build_event_index" (see "event_index.cc")
+f_out = "picked_events.root"
+f_cfg = "pick_events_cfg.py"
+redirector = "root://cmsxrootd.fnal.gov/"		# Prepended to the LFNs
+run = True		# Run the configuration after writing it
+# :VARIABLES
+
+# FUNCTIONS:
+def make_cfg(files, events):
+	cfg = 'import FWCore.ParameterSet.Config as cms\n\n'
+	cfg += 'process = cms.Process("PICK")\n'
+	cfg += 'process.source = cms.Source("PoolSource",\n'
+	cfg += '\tfileNames = cms.untracked.vstring(\n'
+	cfg += "".join('\t\t"{}",\n'.format(redirector + f if f.startswith("/store/") else f) for f in files)
+	cfg += '\t),\n'
+	cfg += '\teventsToProcess = cms.untracked.VEventRange(\n'
+	cfg += "".join('\t\t"{}",\n'.format(e) for e in events)
+	cfg += '\t),\n'
+	cfg += '\tduplicateCheckMode = cms.untracked.string("noDuplicateCheck"),\n'
+	cfg += ')\n'
+	cfg += 'process.out = cms.OutputModule("PoolOutputModule", fileName = cms.untracked.string("{}"))\n'.format(f_out)
+	cfg += 'process.end = cms.EndPath(process.out)\n'
+	return cfg
+
+def main():
+	events_path = sys.argv[1] if len(sys.argv) > 1 else f_events
+	index_path = sys.argv[2] if len(sys.argv) > 2 else f_index
+	events = [l.strip() for l in open(events_path) if l.strip()]
+
+	# Look up each event's file:
+	gROOT.SetBatch()
+	gROOT.ProcessLine(".L event_index.cc+")
+	from ROOT import event_index
+	index = event_index(index_path)
+	files = OrderedDict()		# File -> events, in the order they were first asked for
+	missing = []
+	for e in events:
+		run_n, lumi_n, event_n = [int(x) for x in e.split(":")]
+		f = str(index.find(run_n, lumi_n, event_n))
+		if f: files.setdefault(f, []).append(e)
+		else: missing.append(e)
+	print "[..] Found {} of {} events in {} files.".format(len(events) - len(missing), len(events), len(files))
+	if missing:
+		with open("events_missing.txt", "w") as out: out.write("\n".join(missing) + "\n")
+		print "[!!] WARNING: {} events aren't in {}. They're in \"events_missing.txt\" (use \"pick_events.sh\" on it).".format(len(missing), index_path)
+	if not files: return False
+
+	# Write and run the configuration:
+	picked = [e for f in files for e in files[f]]
+	with open(f_cfg, "w") as out: out.write(make_cfg(files.keys(), picked))
+	print "[OK] Wrote {}.".format(f_cfg)
+	if run:
+		if os.system("cmsRun {}".format(f_cfg)) != 0:
+			print "[!!] ERROR: cmsRun {} failed, so {} might be missing events.".format(f_cfg, f_out)
+			return False
+		print "[OK] Picked events are in {}.".format(f_out)
+	return True
+# :FUNCTIONS
+
+# MAIN:
+if __name__ == "__main__":
+	main()
+# :MAIN
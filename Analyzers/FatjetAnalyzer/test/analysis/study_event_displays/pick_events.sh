@@ -1,5 +1,6 @@
 #!/bin/bash
 
+echo "[--] Note: \"pick_events.py\" picks indexed events much faster; this is the fallback for the rest (\"events_missing.txt\")."
 echo "[--] Note: this script only works with >= CMSSW_9_*, so make sure you've cmsenved there first."
 
 eval "$(edmPickEvents.py --output=jetht16b '/JetHT/Run2016B-03Feb2017_ver2-v2/MINIAOD' events.txt)"
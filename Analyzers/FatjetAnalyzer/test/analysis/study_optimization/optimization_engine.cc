@@ -0,0 +1,206 @@
+// Cut optimization engine for the tau21, tau42, and tau43 scans.
+//
+// "optimization_tau21_plotter.cc" drew mavg_p once per tau21 threshold and per
+// dataset, and "optimization_matrix_plotter.cc" needed an mavg_p histogram for
+// every (tau42, tau43) grid point. Here each dataset is read once, into a table
+// of weights binned in (Max$(tau21), Max$(tau42), Max$(tau43), mavg_p). The tau
+// axes are binned by the scanned thresholds and the mass axis by the edges of
+// the mass windows. Prefix sums over all four axes (a summed-area table) then
+// give the yield for any combination of upper tau cuts in any of those mass
+// windows with two lookups.
+//
+// The outputs are the files that the summary and matrix plotters made, with
+// the same histogram names ("sq<m>to4j_s<kind>"), so the stylers still work:
+//     optimization_summary_plots_43tau<tau43>_42tau<tau42>.root: significance vs. the tau21 cut
+//     optimization_matrices.root: significance vs. the tau42 and tau43 cuts
+// Usage:
+//     root -l -b -q 'optimization_engine.cc+("~/anatuples/anatuple_cutpt400eta25_prextau.root")'
+
+#include <Deracination/Straphanger/test/decortication/macros/optimization_tools/optimization_tools.cc>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+#include "TH1F.h"
+#include "TH2F.h"
+#include "TStopwatch.h"
+
+using namespace std;
+
+class cut_table {
+	public:
+		vector<vector<double>> thresholds;      // The upper cuts on each tau axis
+		vector<double> mass_edges;
+		vector<double> table;
+
+		cut_table(vector<vector<double>> thresholds_in, vector<double> mass_edges_in) : thresholds(thresholds_in), mass_edges(mass_edges_in) {
+			// Each tau axis has a slot per threshold (the entries that pass that cut but not the one below it) and one for the entries that pass none:
+			for (unsigned a = 0; a < 3; ++a) size.push_back(thresholds[a].size() + 1);
+			size.push_back(mass_edges.size() + 1);
+			table.assign(size[0]*size[1]*size[2]*size[3], 0);
+		}
+
+		void fill(const double* tau, double m, double w) {
+			unsigned slot[4];
+			for (unsigned a = 0; a < 3; ++a) slot[a] = upper_bound(thresholds[a].begin(), thresholds[a].end(), tau[a]) - thresholds[a].begin();
+			slot[3] = upper_bound(mass_edges.begin(), mass_edges.end(), m) - mass_edges.begin();
+			table[index(slot)] += w;
+		}
+
+		void integrate() {
+			// Turn the table into prefix sums, one axis at a time:
+			for (unsigned a = 0; a < 4; ++a) {
+				unsigned stride = 1;
+				for (unsigned b = a + 1; b < 4; ++b) stride *= size[b];
+				for (unsigned i = 0; i < table.size(); ++i) {
+					if ((i/stride) % size[a] != 0) table[i] += table[i - stride];
+				}
+			}
+		}
+
+		double yield(unsigned k21, unsigned k42, unsigned k43, unsigned im_lo, unsigned im_hi) const {
+			// The yield with tau < thresholds[k] on each axis (k = the number of thresholds: no cut) and mass_edges[im_lo] <= mavg_p < mass_edges[im_hi]:
+			unsigned hi[4] = {k21, k42, k43, im_hi};
+			unsigned lo[4] = {k21, k42, k43, im_lo};
+			return table[index(hi)] - table[index(lo)];
+		}
+
+		unsigned cut_index(unsigned axis, double cut) const {
+			// The index of the threshold "cut" (or "no cut", for a negative one):
+			if (cut < 0) return thresholds[axis].size();
+			return lower_bound(thresholds[axis].begin(), thresholds[axis].end(), cut - 1e-9) - thresholds[axis].begin();
+		}
+
+	private:
+		vector<unsigned> size;
+		unsigned index(const unsigned* slot) const {
+			return ((slot[0]*size[1] + slot[1])*size[2] + slot[2])*size[3] + slot[3];
+		}
+};
+
+vector<double> get_thresholds(int nbins, double min, double max, vector<double> extra) {
+	// The bin centers that the plotters used as cuts, plus any other cut that's needed:
+	vector<double> thresholds = extra;
+	for (int i = 0; i < nbins; ++i) thresholds.push_back(min + (i + 0.5)*(max - min)/nbins);
+	sort(thresholds.begin(), thresholds.end());
+	thresholds.erase(unique(thresholds.begin(), thresholds.end(), [](double a, double b) {return fabs(a - b) < 1e-9;}), thresholds.end());
+	return thresholds;
+}
+
+cut_table* fill_cut_table(TTree* tt, TString selection, const vector<vector<double>>& thresholds, const vector<double>& mass_edges) {
+	cut_table* result = new cut_table(thresholds, mass_edges);
+	TTreeFormula* f_w = new TTreeFormula("w", selection, tt);
+	vector<TTreeFormula*> f_tau = {new TTreeFormula("tau21", "Max$(tau21)", tt), new TTreeFormula("tau42", "Max$(tau42)", tt), new TTreeFormula("tau43", "Max$(tau43)", tt)};
+	TTreeFormula* f_m = new TTreeFormula("m", "mavg_p", tt);
+	Long64_t n = tt->GetEntries();
+	for (Long64_t i = 0; i < n; ++i) {
+		tt->LoadTree(i);		// The formulas read only the branches that they need.
+		if (f_w->GetNdata() == 0) continue;
+		double w = f_w->EvalInstance();
+		if (w == 0) continue;
+		double tau[3];
+		for (unsigned a = 0; a < 3; ++a) tau[a] = f_tau[a]->EvalInstance();
+		result->fill(tau, f_m->EvalInstance(), w);
+	}
+	result->integrate();
+	delete f_w;
+	delete f_m;
+	for (auto f : f_tau) delete f;
+	return result;
+}
+
+void optimization_engine(TString f_in="~/anatuples/anatuple_cutpt400eta25_prextau.root", int window=50, double tau42_fixed=0.45, double tau43_fixed=0.80, double tau21_fixed=-1) {
+	gROOT->SetBatch();
+	gStyle->SetOptStat(0);
+	TStopwatch timer;
+	vector<int> ms = {100, 150, 175, 200, 250, 300, 400, 500};
+	TString selection = "wtt*w*(deta<1.0&&masy_p<0.1)";
+
+	// Binning:
+	int tau21nbins = 50, tau42nbins = 20, tau43nbins = 20;
+	double tau21min = 0.5, tau21max = 1.0, tau42min = 0.3, tau42max = 0.8, tau43min = 0.5, tau43max = 1.0;
+	vector<double> extra21 = {}, extra42 = {tau42_fixed}, extra43 = {tau43_fixed};
+	if (tau21_fixed >= 0) extra21.push_back(tau21_fixed);
+	vector<vector<double>> thresholds = {
+		get_thresholds(tau21nbins, tau21min, tau21max, extra21),
+		get_thresholds(tau42nbins, tau42min, tau42max, extra42),
+		get_thresholds(tau43nbins, tau43min, tau43max, extra43),
+	};
+	/// The mass windows are [m - window/2, m + window/2] in 1-GeV bins, like "FindBin" and "Integral" on the old plots:
+	vector<double> mass_edges;
+	for (int m : ms) {
+		mass_edges.push_back(m - window/2);
+		mass_edges.push_back(m + window/2 + 1);
+	}
+	sort(mass_edges.begin(), mass_edges.end());
+	mass_edges.erase(unique(mass_edges.begin(), mass_edges.end()), mass_edges.end());
+	auto window_of = [&](int m, unsigned& lo, unsigned& hi) {
+		lo = lower_bound(mass_edges.begin(), mass_edges.end(), m - window/2) - mass_edges.begin();
+		hi = lower_bound(mass_edges.begin(), mass_edges.end(), m + window/2 + 1) - mass_edges.begin();
+	};
+
+	// Fill one table per dataset:
+	TFile* tf_in = TFile::Open(f_in);
+	map<TString, cut_table*> tables;
+	vector<TString> names = {"qcdmg", "ttbar"};
+	for (int m : ms) names.push_back("sq" + to_string(m) + "to4j");
+	for (auto& name : names) {
+		cout << "[..] Filling the cut table for " << name << "." << endl;
+		tables[name] = fill_cut_table((TTree*) tf_in->Get(name), selection, thresholds, mass_edges);
+	}
+
+	// Significance vs. the tau21 cut (what "optimization_tau21_summary_plotter.cc" made):
+	TString name_summary_file = "optimization_summary_plots_43tau" + to_string((int) round(tau43_fixed*1000)) + "_42tau" + to_string((int) round(tau42_fixed*1000)) + ".root";
+	TFile* tf_summary = new TFile(name_summary_file, "RECREATE");
+	unsigned k42 = tables["qcdmg"]->cut_index(1, tau42_fixed), k43 = tables["qcdmg"]->cut_index(2, tau43_fixed);
+	for (int m : ms) {
+		unsigned im_lo, im_hi;
+		window_of(m, im_lo, im_hi);
+		cut_table* signal = tables["sq" + to_string(m) + "to4j"];
+		for (int kind = 1; kind < 5; ++kind) {
+			TString name_summary = "sq" + to_string(m) + "to4j_s" + to_string(kind);
+			TH1F* summary = new TH1F(name_summary, "", tau21nbins, tau21min, tau21max);
+			for (int i = 1; i <= tau21nbins; ++i) {
+				unsigned k21 = signal->cut_index(0, summary->GetXaxis()->GetBinCenter(i));
+				double s = signal->yield(k21, k42, k43, im_lo, im_hi);
+				double b = tables["qcdmg"]->yield(k21, k42, k43, im_lo, im_hi) + tables["ttbar"]->yield(k21, k42, k43, im_lo, im_hi);
+				summary->SetBinContent(i, s > 0 && b > 0 ? significance(kind, s, b) : 0);
+			}
+			tf_summary->WriteTObject(summary);
+		}
+	}
+	tf_summary->Close();
+
+	// Significance vs. the tau42 and tau43 cuts (what "optimization_matrix_plotter.cc" made):
+	TFile* tf_matrices = new TFile("optimization_matrices.root", "RECREATE");
+	unsigned k21 = tables["qcdmg"]->cut_index(0, tau21_fixed);
+	for (int m : ms) {
+		unsigned im_lo, im_hi;
+		window_of(m, im_lo, im_hi);
+		cut_table* signal = tables["sq" + to_string(m) + "to4j"];
+		for (int kind = 1; kind < 5; ++kind) {
+			TString name_matrix = "sq" + to_string(m) + "to4j_s" + to_string(kind);
+			TH2F* matrix = new TH2F(name_matrix, "", tau42nbins, tau42min, tau42max, tau43nbins, tau43min, tau43max);
+			for (int i = 1; i <= tau42nbins; ++i) {
+				for (int j = 1; j <= tau43nbins; ++j) {
+					unsigned ki = signal->cut_index(1, matrix->GetXaxis()->GetBinCenter(i));
+					unsigned kj = signal->cut_index(2, matrix->GetYaxis()->GetBinCenter(j));
+					double s = signal->yield(k21, ki, kj, im_lo, im_hi);
+					double b_qcd = tables["qcdmg"]->yield(k21, ki, kj, im_lo, im_hi);
+					double b_ttbar = tables["ttbar"]->yield(k21, ki, kj, im_lo, im_hi);
+					double b = b_qcd + b_ttbar;
+					if (b_qcd == 0 && b_ttbar < 15) b = 0;
+					matrix->SetBinContent(i, j, s > 0 && b > 0 ? significance(kind, s, b, false) : 0);
+				}
+			}
+			tf_matrices->WriteTObject(matrix);
+		}
+	}
+	tf_matrices->Close();
+	cout << "[OK] Wrote " << name_summary_file << " and optimization_matrices.root in " << timer.RealTime() << " s." << endl;
+}
@@ -0,0 +1,113 @@
+// nminusone_engine: fills every N-1 distribution of a selection from one loop
+// over each tree.
+//
+// The selection (a key of "cuts.yaml") is split into its top-level "&&" terms,
+// and each term is evaluated once per event into a bit of a mask. An N-1 plot
+// drops some of the terms (the ones that mention its variable, like "deta" or
+// "tau21"), so it's filled if the mask has every other bit set. Terms are
+// only evaluated until the event misses more terms than any plot drops. A
+// selection that isn't in "cuts.yaml", or that has more than 32 terms (the
+// mask's bits), is refused: "valid" is false, and nothing is filled.
+
+#ifndef NMINUSONE_ENGINE
+#define NMINUSONE_ENGINE
+
+#include <Analyzers/FatjetAnalyzer/test/analysis/anatuple_cutter.cc>		// "read_cuts", "split_terms", and "pass_formula"
+#include <iostream>
+#include <vector>
+#include "TString.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+#include "TH1F.h"
+
+using namespace std;
+
+class nminusone_engine {
+	public:
+		struct plot_info {
+			TString key;                // The histograms are named "<key>_<tree>_<cut_key>x<key>"
+			TString expression;
+			int n;
+			double lo, hi;
+			vector<TString> matches;    // The terms that mention any of these are dropped
+			unsigned drop;              // (Set by the engine.)
+		};
+
+		TString cut_key;
+		bool valid = false;
+		vector<TString> terms;
+		vector<plot_info> plots;
+
+		nminusone_engine(TString cut_key_in="sig", TString cuts_path="cuts.yaml") : cut_key(cut_key_in) {
+			map<TString, TString> cuts = read_cuts(cuts_path);
+			if (cuts.find(cut_key) == cuts.end()) {
+				cout << "[!!] ERROR: " << cut_key << " isn't in " << cuts_path << "." << endl;
+				return;
+			}
+			terms = split_terms(cuts[cut_key]);
+			if (terms.size() > 32) {
+				cout << "[!!] ERROR: " << cut_key << " has " << terms.size() << " terms, but there can only be 32." << endl;
+				terms.clear();
+				return;
+			}
+			valid = true;
+		}
+
+		void add_plot(TString key, TString expression, int n, double lo, double hi, vector<TString> matches={}) {
+			if (matches.empty()) matches = {expression};
+			if (!valid) return;
+			unsigned drop = 0;
+			for (unsigned i = 0; i < terms.size(); ++i) {
+				for (auto& match : matches) {
+					if (terms[i].Contains(match)) drop |= 1u << i;
+				}
+			}
+			if (!drop) cout << "[!!] WARNING: No term of " << cut_key << " mentions " << key << "." << endl;
+			plots.push_back({key, expression, n, lo, hi, matches, drop});
+		}
+
+		vector<TH1*> fill(TTree* tt, TString weight="w") {
+			TString tt_name = tt->GetName();
+			vector<TH1*> hs;
+			if (!valid) return hs;
+			for (auto& plot : plots) {
+				TH1* h = new TH1F(plot.key + "_" + tt_name + "_" + cut_key + "x" + plot.key, "", plot.n, plot.lo, plot.hi);
+				h->SetDirectory(0);
+				h->Sumw2();
+				hs.push_back(h);
+			}
+
+			vector<TTreeFormula*> f_terms;
+			for (unsigned i = 0; i < terms.size(); ++i) f_terms.push_back(new TTreeFormula(TString::Format("term%d", i), terms[i], tt));
+			vector<TTreeFormula*> f_vars;
+			for (auto& plot : plots) f_vars.push_back(new TTreeFormula(plot.key, plot.expression, tt));
+			TTreeFormula* f_w = new TTreeFormula("weight", weight, tt);
+			unsigned all = terms.size() == 32 ? ~0u : (1u << terms.size()) - 1;
+			int max_missing = 0;
+			for (auto& plot : plots) max_missing = max(max_missing, __builtin_popcount(plot.drop));
+
+			Long64_t n = tt->GetEntries();
+			for (Long64_t i = 0; i < n; ++i) {
+				tt->LoadTree(i);		// The formulas read only the branches that they need.
+				unsigned mask = 0;
+				int missing = 0;
+				for (unsigned j = 0; j < f_terms.size() && missing <= max_missing; ++j) {
+					if (pass_formula(f_terms[j])) mask |= 1u << j;
+					else missing++;
+				}
+				if (missing > max_missing) continue;
+				double w = f_w->EvalInstance();
+				if (w == 0) continue;
+				for (unsigned k = 0; k < plots.size(); ++k) {
+					if ((mask | plots[k].drop) != all) continue;
+					for (int l = 0; l < f_vars[k]->GetNdata(); ++l) hs[k]->Fill(f_vars[k]->EvalInstance(l), w);
+				}
+			}
+			for (auto f : f_terms) delete f;
+			for (auto f : f_vars) delete f;
+			delete f_w;
+			return hs;
+		}
+};
+
+#endif
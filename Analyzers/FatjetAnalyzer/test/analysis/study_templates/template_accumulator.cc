@@ -0,0 +1,271 @@
+// template_accumulator: fills the single-jet (m, eta, HT) distributions of
+// many templates from one loop over each tree.
+//
+// "template_plotter.cc" used to book a dense 1200x20x25 TH3D for each dataset,
+// cut and groomer and fill it with its own "TTree::Draw". Here every plot is
+// booked first ("book"), as a list of (tree, selection, groomer) contributions,
+// and "run" then reads each tree once, filling every plot that it contributes
+// to. The plots are kept sparse (only filled bins are stored), and a dense TH3D
+// is only made for one plot at a time, when "make_th3" is called.
+//
+// With "n_replicas" = K > 0, every plot also carries K Poisson-bootstrap
+// replicas, filled in the same pass: each event enters replica k with a weight
+// multiplied by m_k ~ Poisson(1). The m_k are drawn from a generator seeded
+// with the event's (run, lumi, event) and "seed", so an event gets the same m_k
+// in every plot, and every run gives the same replicas. The MC samples all use
+// run 1 and reuse the same lumi and event numbers, so for them a hash of the
+// tree name is mixed in too (otherwise, say, the QCD and ttbar events with the
+// same numbers would get the same m_k, and the replicas would be correlated
+// across the samples). A data event gets the same m_k in every tree. A filled bin
+// keeps its K sums of weights next to each other, so a fill is one draw of K
+// numbers per event and one loop over K per bin (not K fills). Make a replica
+// with "make_th3(name, k)"; its bin errors are the nominal ones.
+
+#ifndef TEMPLATE_ACCUMULATOR
+#define TEMPLATE_ACCUMULATOR
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+#include "TH1D.h"
+#include "TH3D.h"
+#include "TStopwatch.h"
+
+using namespace std;
+
+class sparse_th3 {
+	// Sums of weights and of weights squared for the filled bins of a 3D binning:
+	public:
+		vector<double> edges_x, edges_y, edges_z;
+		unordered_map<long, pair<double, double>> bins;
+		unsigned n_replicas = 0;
+		unordered_map<long, vector<double>> replicas;      // The sums of weights of each replica in each filled bin
+
+		sparse_th3() {}
+		sparse_th3(const vector<double>& x, const vector<double>& y, const vector<double>& z, unsigned n_replicas_in=0) : edges_x(x), edges_y(y), edges_z(z), n_replicas(n_replicas_in) {}
+
+		void fill(double x, double y, double z, double w, const double* counts=0) {
+			// (Under- and overflow bins are kept, like in a TH3.) "counts" are the event's bootstrap multiplicities:
+			long i = index(find_bin(edges_x, x), find_bin(edges_y, y), find_bin(edges_z, z));
+			auto& bin = bins[i];
+			bin.first += w;
+			bin.second += w*w;
+			if (n_replicas && counts) {
+				vector<double>& r = replicas[i];
+				if (r.empty()) r.assign(n_replicas, 0);
+				double* sums = &r[0];
+				for (unsigned k = 0; k < n_replicas; ++k) sums[k] += w*counts[k];
+			}
+		}
+
+		void add(const sparse_th3& other) {
+			for (auto& bin : other.bins) {
+				bins[bin.first].first += bin.second.first;
+				bins[bin.first].second += bin.second.second;
+			}
+			if (n_replicas != other.n_replicas) return;
+			for (auto& bin : other.replicas) {
+				vector<double>& r = replicas[bin.first];
+				if (r.empty()) r.assign(n_replicas, 0);
+				for (unsigned k = 0; k < n_replicas; ++k) r[k] += bin.second[k];
+			}
+		}
+
+		TH3D* make_th3(TString name, int replica=-1) const {
+			// The plot, or (with 0 <= "replica" < n_replicas) one of its bootstrap replicas:
+			TH3D* h = new TH3D(name, "", edges_x.size() - 1, &edges_x[0], edges_y.size() - 1, &edges_y[0], edges_z.size() - 1, &edges_z[0]);
+			h->Sumw2();
+			double n = 0;
+			for (auto& bin : bins) {
+				int ix, iy, iz;
+				unindex(bin.first, ix, iy, iz);
+				double content = bin.second.first;
+				if (replica >= 0) {
+					auto r = replicas.find(bin.first);
+					content = r != replicas.end() ? r->second[replica] : 0;
+				}
+				h->SetBinContent(ix, iy, iz, content);
+				h->SetBinError(ix, iy, iz, sqrt(bin.second.second));
+				if (bin.second.second > 0) n += bin.second.first*bin.second.first/bin.second.second;
+			}
+			h->SetEntries(n);		// The effective number of entries
+			return h;
+		}
+
+		TH1D* projection_x(TString name, int iy_lo=0, int iy_hi=-1, int iz_lo=0, int iz_hi=-1) const {
+			// The m distribution in a range of eta and HT bins (the whole range, with under- and overflow, by default):
+			if (iy_hi < 0) iy_hi = edges_y.size();
+			if (iz_hi < 0) iz_hi = edges_z.size();
+			TH1D* h = new TH1D(name, "", edges_x.size() - 1, &edges_x[0]);
+			h->Sumw2();
+			vector<double> sumw(edges_x.size() + 1, 0), sumw2(edges_x.size() + 1, 0);
+			for (auto& bin : bins) {
+				int ix, iy, iz;
+				unindex(bin.first, ix, iy, iz);
+				if (iy < iy_lo || iy > iy_hi || iz < iz_lo || iz > iz_hi) continue;
+				sumw[ix] += bin.second.first;
+				sumw2[ix] += bin.second.second;
+			}
+			for (unsigned ix = 0; ix < sumw.size(); ++ix) {
+				h->SetBinContent(ix, sumw[ix]);
+				h->SetBinError(ix, sqrt(sumw2[ix]));
+			}
+			return h;
+		}
+
+	private:
+		static int find_bin(const vector<double>& edges, double value) {
+			return upper_bound(edges.begin(), edges.end(), value) - edges.begin();		// 0: underflow, edges.size(): overflow
+		}
+		long index(int ix, int iy, int iz) const {
+			return ((long) iz*(edges_y.size() + 1) + iy)*(edges_x.size() + 1) + ix;
+		}
+		void unindex(long i, int& ix, int& iy, int& iz) const {
+			ix = i % (edges_x.size() + 1);
+			i /= edges_x.size() + 1;
+			iy = i % (edges_y.size() + 1);
+			iz = i/(edges_y.size() + 1);
+		}
+};
+
+class poisson_bootstrap {
+	// Poisson(1) multiplicities for an event, from a generator seeded with its (run, lumi, event), and "salt" for MC:
+	public:
+		vector<double> counts;
+
+		poisson_bootstrap(unsigned n=0, unsigned long long seed_in=0, unsigned long long salt_in=0) : counts(n, 1), seed(seed_in), salt(salt_in) {
+			double p = exp(-1.0), sum = 0;
+			for (int m = 0; m < 20; ++m) {
+				sum += p;
+				cdf.push_back(sum);
+				p /= m + 1;
+			}
+		}
+
+		const double* draw(unsigned long long run, unsigned long long lumi, unsigned long long event) {
+			unsigned long long state = mix(mix(mix(seed ^ run) ^ lumi) ^ event);
+			if (run == 1) state = mix(state ^ salt);		// MC
+			for (unsigned k = 0; k < counts.size(); ++k) {
+				double u = (mix(state + k) >> 11)*(1.0/9007199254740992.0);		// Uniform in [0, 1)
+				unsigned m = 0;
+				while (m + 1 < cdf.size() && u >= cdf[m]) m++;
+				counts[k] = m;
+			}
+			return counts.empty() ? 0 : &counts[0];
+		}
+
+	private:
+		unsigned long long seed, salt;
+		vector<double> cdf;
+		static unsigned long long mix(unsigned long long x) {
+			// The "splitmix64" finalizer:
+			x += 0x9e3779b97f4a7c15ULL;
+			x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+			x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+			return x ^ (x >> 31);
+		}
+};
+
+class template_accumulator {
+	public:
+		vector<double> bins_m, bins_eta, bins_ht;
+		unsigned n_replicas = 0;        // Poisson-bootstrap replicas per plot (set before booking)
+		unsigned long long seed = 0;
+
+		template_accumulator() {
+			// The binning of "fill_fj_plot":
+			for (double i = 0; i <= 1200; i += 1) bins_m.push_back(i);
+			for (double i = -2.0; i < 2.1; i += 0.2) bins_eta.push_back(i);
+			for (double i = 900; i <= 3200; i += 92) bins_ht.push_back(i);
+		}
+
+		void book(TString name, TString tree, TString selection, TString groomer="p") {
+			// Add a (tree, selection, groomer) contribution to the plot called "name":
+			if (plots.find(name) == plots.end()) plots[name] = sparse_th3(bins_m, bins_eta, bins_ht, n_replicas);
+			for (auto& c : contributions[tree]) {
+				if (c.name == name && c.selection == selection && c.m == "m_" + groomer + "[0]") return;		// Already booked
+			}
+			contributions[tree].push_back({name, selection, "m_" + groomer + "[0]"});
+		}
+
+		void run(TFile* tf_in) {
+			// Read each booked tree once:
+			TStopwatch timer;
+			for (auto& tree_contributions : contributions) {
+				TTree* tt = (TTree*) tf_in->Get(tree_contributions.first);
+				if (!tt) {
+					cout << "[!!] ERROR: " << tree_contributions.first << " isn't in " << tf_in->GetName() << "." << endl;
+					continue;
+				}
+				cout << "[..] Filling " << tree_contributions.second.size() << " plot contribution(s) from " << tree_contributions.first << "." << endl;
+				fill_tree(tt, tree_contributions.second);
+			}
+			cout << "[OK] Filled the single jet distributions in " << timer.RealTime() << " s." << endl;
+		}
+
+		const sparse_th3& get(TString name) {return plots[name];}
+		TH3D* make_th3(TString name, int replica=-1) {return plots[name].make_th3(replica < 0 ? name : name + TString::Format("_r%d", replica), replica);}
+
+	private:
+		struct contribution {TString name, selection, m;};
+		map<TString, sparse_th3> plots;
+		map<TString, vector<contribution>> contributions;
+
+		void fill_tree(TTree* tt, const vector<contribution>& cs) {
+			map<TString, TTreeFormula*> formulas;
+			auto compile = [&](TString expression) {
+				if (formulas.find(expression) == formulas.end()) formulas[expression] = new TTreeFormula("f" + TString::Format("%d", (int) formulas.size()), expression, tt);
+				return formulas[expression];
+			};
+			TTreeFormula* f_ht = compile("htak8");
+			TTreeFormula* f_eta = compile("eta[0]");
+			TTreeFormula* f_run = 0;
+			TTreeFormula* f_lumi = 0;
+			TTreeFormula* f_event = 0;
+			if (n_replicas) {
+				f_run = compile("run");
+				f_lumi = compile("lumi");
+				f_event = compile("event");
+			}
+			poisson_bootstrap bootstrap(n_replicas, seed, TString(tt->GetName()).Hash());
+			vector<TTreeFormula*> f_w, f_m;
+			for (auto& c : cs) {
+				f_w.push_back(compile(c.selection));
+				f_m.push_back(compile(c.m));
+			}
+
+			Long64_t n = tt->GetEntries();
+			for (Long64_t i = 0; i < n; ++i) {
+				tt->LoadTree(i);		// The formulas read only the branches that they need.
+				bool loaded = false;
+				double ht = 0, eta = 0;
+				const double* counts = 0;
+				for (unsigned ic = 0; ic < cs.size(); ++ic) {
+					// The variables are scalars, so (like "TTree::Draw") there's one fill per instance of the selection:
+					int ndata = f_w[ic]->GetNdata();
+					for (int k = 0; k < ndata; ++k) {
+						double w = f_w[ic]->EvalInstance(k);
+						if (w == 0) continue;
+						if (!loaded) {
+							ht = f_ht->EvalInstance();
+							eta = f_eta->EvalInstance();
+							if (n_replicas) counts = bootstrap.draw((unsigned long long) f_run->EvalInstance(), (unsigned long long) f_lumi->EvalInstance(), (unsigned long long) f_event->EvalInstance());
+							loaded = true;
+						}
+						if (f_eta->GetNdata() == 0 || f_m[ic]->GetNdata() == 0) continue;
+						plots[cs[ic].name].fill(f_m[ic]->EvalInstance(), eta, ht, w, counts);
+					}
+				}
+			}
+			for (auto& f : formulas) delete f.second;
+		}
+};
+
+#endif
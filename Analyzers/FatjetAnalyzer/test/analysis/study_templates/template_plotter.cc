@@ -2,30 +2,19 @@
 #include <sstream>
 #include <string>
 #include <Deracination/Straphanger/test/decortication/macros/common.cc>
+#include <Analyzers/FatjetAnalyzer/test/analysis/study_templates/template_accumulator.cc>
 
 bool VERBOSE = true;
 
-TH3* fill_fj_plot(TTree* tt, TString name, TString cut, TString era, TString groomer="p") {
-	// Set up HT bins:
-//	vector<double> bins_ht = {900, 1000, 2000, 3000};
-//	vector<double> bins_ht = {900, 910, 920, 930, 940, 950, 970, 1000};
-//	for (double i = 1050; i <= 3200; i += 50) bins_ht.push_back(i);
-	vector<double> bins_ht;
-	for (double i = 900; i <= 3200; i += 92) bins_ht.push_back(i);
-	// Set up m bins:
-	vector<double> bins_m;
-	for (double i = 0; i <= 1200; i += 1) bins_m.push_back(i);
-	// Set up eta bins:
-	vector<double> bins_eta;
-//	for (double i = -2.0; i < 2.1; i += 0.1) bins_eta.push_back(i);
-	for (double i = -2.0; i < 2.1; i += 0.2) bins_eta.push_back(i);
-	// Fill histogram:
-	TH3D* h3 = new TH3D(name, "", bins_m.size()-1, &bins_m[0], bins_eta.size()-1, &bins_eta[0], bins_ht.size()-1, &bins_ht[0]);
-	tt->Draw("htak8:eta[0]:m_" + groomer + "[0]>>" + name, get_cut("fj_" + cut, era, get_weight(tt->GetName(), era)));
-	return h3;
+vector<TString> get_fj_trees(TString ds) {
+	// The trees that make up each dataset:
+	if (ds == "inj") return {"jetht", "sq150to4j"};
+	if (ds.BeginsWith("inj")) return {"jetht", "sq" + TString(ds(3, ds.Length())) + "to4j"};		// "inj100", ..., "inj500"
+	if (ds == "all") return {"qcdmg", "ttbar", "sq150to4j"};
+	return {ds};
 }
 
-TH3* make_fj_plot(TFile* tf_in, TFile* tf_out, TString ds, TString cut, TString groomer="p") {
+void book_fj_plot(template_accumulator& acc, TString ds, TString cut, TString groomer="p") {
 	TString name = "fj_" + ds + "_" + cut + "_" + groomer;
 	
 	TString era = "";
@@ -34,66 +23,29 @@ TH3* make_fj_plot(TFile* tf_in, TFile* tf_out, TString ds, TString cut, TString
 		era = "15";
 	}
 	
-	vector<TTree*> tts;
-	if (ds == "inj") {
-		tts.push_back((TTree*) tf_in->Get("jetht"));
-		tts.push_back((TTree*) tf_in->Get("sq150to4j"));
-	}
-	else if (ds == "inj100") {
-		tts.push_back((TTree*) tf_in->Get("jetht"));
-		tts.push_back((TTree*) tf_in->Get("sq100to4j"));
-	}
-	else if (ds == "inj150") {
-		tts.push_back((TTree*) tf_in->Get("jetht"));
-		tts.push_back((TTree*) tf_in->Get("sq150to4j"));
-	}
-	else if (ds == "inj200") {
-		tts.push_back((TTree*) tf_in->Get("jetht"));
-		tts.push_back((TTree*) tf_in->Get("sq200to4j"));
-	}
-	else if (ds == "inj250") {
-		tts.push_back((TTree*) tf_in->Get("jetht"));
-		tts.push_back((TTree*) tf_in->Get("sq250to4j"));
-	}
-	else if (ds == "inj300") {
-		tts.push_back((TTree*) tf_in->Get("jetht"));
-		tts.push_back((TTree*) tf_in->Get("sq300to4j"));
-	}
-	else if (ds == "inj400") {
-		tts.push_back((TTree*) tf_in->Get("jetht"));
-		tts.push_back((TTree*) tf_in->Get("sq400to4j"));
-	}
-	else if (ds == "inj500") {
-		tts.push_back((TTree*) tf_in->Get("jetht"));
-		tts.push_back((TTree*) tf_in->Get("sq500to4j"));
-	}
-	else if (ds == "all") {
-		tts.push_back((TTree*) tf_in->Get("qcdmg"));
-		tts.push_back((TTree*) tf_in->Get("ttbar"));
-		tts.push_back((TTree*) tf_in->Get("sq150to4j"));
-	}
-	else tts.push_back((TTree*) tf_in->Get(ds));
-	
-	TH3* h = fill_fj_plot(tts[0], name, cut, era, groomer);
-	if (ds == "all" || ds == "inj") {
-		for (unsigned i = 1; i < tts.size() ; ++i) {
-			TH3* h_temp = fill_fj_plot(tts[i], "h", cut, era, groomer);
-			h->Add(h_temp);
-		}
-	}
-	// Write out plot:
-	tf_out->WriteTObject(h);
+	vector<TString> trees = get_fj_trees(ds);
+	/// (Only "inj" and "all" used to add up all of their trees; the other "inj*" datasets only used the first one.)
+	if (ds != "all" && ds != "inj") trees.resize(1);
+	for (unsigned i = 0; i < trees.size(); ++i) acc.book(name, trees[i], TString(get_cut("fj_" + cut, era, get_weight(trees[i], era))), groomer);
+}
+
+TH3* make_fj_plot(template_accumulator& acc, TFile* tf_out, TString ds, TString cut, TString groomer="p", int replica=-1) {
+	TString name = "fj_" + ds + "_" + cut + "_" + groomer;
+	TH3* h = acc.make_th3(name, replica);
+	// Write out plot (but not the dense replicas):
+	if (replica < 0) tf_out->WriteTObject(h);
 	return h;
 }
 
-TH1* make_temp_plot(TFile* tf_in, TFile* tf_out, TString ds, TString cut, TString dir="", int f=1, TString groomer="p", bool ht=true){
+TH1* make_temp_plot(template_accumulator& acc, TFile* tf_out, TString ds, TString cut, TString dir="", int f=1, TString groomer="p", bool ht=true, int replica=-1){
 	TString name = "temp_" + ds + "_" + cut + "_" + groomer + "_f" + to_string(f);
 	if (dir != "") name = name + "_" + dir;
 	if (!ht) name = name + "_xht";
+	if (replica >= 0) name = name + "_r" + to_string(replica);		// A bootstrap replica of the template
 	cout << "[..] Making template for " << name << "." << endl;
 	
 	cout << "[..] Making single jet distribution for " << ds << " with " << cut << "." << endl;
-	TH3* h = make_fj_plot(tf_in, tf_out, ds, cut, groomer);
+	TH3* h = make_fj_plot(acc, tf_out, ds, cut, groomer, replica);
 	cout << "[OK] Made the single jet distribution." << endl;
 //	cout << "[OK] The single jet distribution has the following binning:" << endl;
 //	cout << "HT: " << h->GetNbinsZ() << " bins." << endl;
@@ -104,11 +56,15 @@ TH1* make_temp_plot(TFile* tf_in, TFile* tf_out, TString ds, TString cut, TStrin
 	TH1* temp = make_template(tf_out, name, h, ds, cut, dir, f, 0.1, 1.0, ht);
 //	cout << "here" << endl;
 	temp->SetName(name);
+	delete h;		// (Only one dense single jet distribution is kept in memory at a time.)
 	cout << "[OK] Template constructed." << endl;
 	return temp;
 }
 
-void template_plotter(TString cut="sb", bool ht=true) {
+void template_plotter(TString cut="sb", bool ht=true, int n_replicas=0) {
+	// With "n_replicas" > 0, each template also gets that many Poisson-bootstrap replicas ("temp_..._r<k>"), made from
+	// the same pass over the anatuple, so the fit can be repeated on each one to get the template's statistical
+	// uncertainty (see "closure_replicas" in "closure_plotter.cc").
 	// Options:
 	gROOT->SetBatch();
 	
@@ -123,14 +79,21 @@ void template_plotter(TString cut="sb", bool ht=true) {
 //	vector<TString> dss = {"inj"};
 	vector<TString> dss = {"qcdmg", "qcdp"};
 	
+	// Fill the single jet distributions of every dataset from one pass over the anatuple:
+	TString ana_option = "";
+	TFile* tf_in = get_ana(ana_option);
+	template_accumulator acc;
+	acc.n_replicas = n_replicas;
+	for (unsigned i = 0; i < dss.size(); ++i) book_fj_plot(acc, dss[i], cut, "p");
+	acc.run(tf_in);
+	
 	// Make plots:
 	for (unsigned i = 0; i < dss.size(); ++i) {
 		TString ds = dss[i];
-		TString ana_option = "";
-		TFile* tf_in = get_ana(ana_option);
-//		make_temp_plot(tf_in, tf_out, ds, cut);
-		make_temp_plot(tf_in, tf_out, ds, cut, "", 1, "p", ht);
-//		if (dss[i] != "inj") make_temp_plot(tf_in, tf_out, dss[i], cut, "", 1, "p", false);
+//		make_temp_plot(acc, tf_out, ds, cut);
+		make_temp_plot(acc, tf_out, ds, cut, "", 1, "p", ht);
+		for (int k = 0; k < n_replicas; ++k) make_temp_plot(acc, tf_out, ds, cut, "", 1, "p", ht, k);
+//		if (dss[i] != "inj") make_temp_plot(acc, tf_out, dss[i], cut, "", 1, "p", false);
 	}
 //	make_temp_plot(tf_in_ext, tf_out, "qcdmg", cut);
 //	make_temp_plot(tf_in_ext, tf_out, "qcdmg", cut, "", 1, "p", false);
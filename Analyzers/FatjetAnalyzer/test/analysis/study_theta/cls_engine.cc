@@ -0,0 +1,386 @@
+// cls_engine: asymptotic CLs limits on the signal strength ("beta_signal")
+// from a "theta_plots_*.root" file, without theta.
+//
+// The model is the one that "limits.py" builds: every "mavg__<process>" is a
+// process ("DATA" is the data, and processes whose names start with "Ms" are
+// signals), "mavg__<process>__<nuisance>__plus/minus" are shape variations, and
+// "add_lognormal_uncertainty" adds a lognormal normalization uncertainty. Each
+// nuisance parameter has a unit Gaussian constraint. The shapes are morphed
+// per bin, with a polynomial between the variations that matches them and their
+// slopes at +/-1 sigma and a linear extrapolation outside, so the likelihood
+// and its gradient are analytic:
+//     f(t) = t/2*(d+ - d-) + s(t)/2*(d+ + d-),  s(t) = (3t^6 - 10t^4 + 15t^2)/8  (|t| < 1)
+//     f(t) = t*d+ (t > 1), -t*d- (t < -1)
+// where d+/- are the plus/minus histograms minus the nominal one.
+//
+// For each signal, the nuisance parameters are profiled with Minuit2 and the
+// limit is the beta_signal with CLs = 0.05, using the asymptotic formulae for
+// the q~_mu test statistic (Cowan, Cranmer, Gross, Vitells). The expected limit
+// and its bands come from the background-only Asimov dataset. With "n_toys" >
+// 0, the expected band comes instead from the quantiles of the limits of
+// background-only toys, with the nuisance parameters drawn from their
+// constraints. The signals (and the toys) are run in parallel.
+//
+// The output is the "expected_<name>.txt" and "observed_<name>.txt" files that
+// theta wrote, which "limit_plotter.py" reads. It's run by "limits_cls.py".
+
+#ifndef CLS_ENGINE
+#define CLS_ENGINE
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include "TString.h"
+#include "TFile.h"
+#include "TKey.h"
+#include "TCollection.h"
+#include "TList.h"
+#include "TH1.h"
+#include "TMath.h"
+#include "TRandom3.h"
+#include "TROOT.h"
+#include "TStopwatch.h"
+#include "Math/IFunction.h"
+#include "Math/Minimizer.h"
+#include "Math/Factory.h"
+
+using namespace std;
+
+class cls_model : public ROOT::Math::IMultiGradFunction {
+	public:
+		struct shape {unsigned par; vector<double> plus, minus;};
+		struct process {
+			TString name;
+			bool signal;
+			vector<double> nominal;
+			vector<shape> shapes;
+			vector<pair<unsigned, double>> norms;      // (parameter, log(kappa))
+		};
+
+		vector<TString> names;      // Parameter 0 is beta_signal, the others are nuisance parameters
+		vector<process> processes;  // The backgrounds and one signal
+		vector<double> data;
+
+		unsigned int NDim() const override {return names.size();}
+		ROOT::Math::IMultiGradFunction* Clone() const override {return new cls_model(*this);}
+
+		void expected(const double* par, vector<double>& lambda) const {
+			lambda.assign(data.size(), 0);
+			for (auto& p : processes) {
+				double norm = p.signal ? par[0] : 1;
+				for (auto& n : p.norms) norm *= exp(n.second*par[n.first]);
+				for (unsigned i = 0; i < lambda.size(); ++i) {
+					double y = p.nominal[i];
+					for (auto& s : p.shapes) y += morph(par[s.par], s.plus[i], s.minus[i]);
+					lambda[i] += norm*y;
+				}
+			}
+		}
+
+		void FdF(const double* par, double& value, double* gradient) const override {
+			// The negative log likelihood (relative to the saturated model) and its gradient:
+			vector<double> lambda;
+			expected(par, lambda);
+			vector<double> r(data.size());
+			value = 0;
+			for (unsigned i = 0; i < data.size(); ++i) {
+				double l = max(lambda[i], 1e-9);
+				value += l - data[i] + (data[i] > 0 ? data[i]*log(data[i]/l) : 0);
+				r[i] = 1 - data[i]/l;
+			}
+			for (unsigned k = 0; k < NDim(); ++k) gradient[k] = k ? par[k] : 0;
+			for (unsigned k = 1; k < NDim(); ++k) value += par[k]*par[k]/2;
+			for (auto& p : processes) {
+				double norm_nuisance = 1;
+				for (auto& n : p.norms) norm_nuisance *= exp(n.second*par[n.first]);
+				double norm = (p.signal ? par[0] : 1)*norm_nuisance;
+				double dot = 0;      // sum_i r_i*y_i
+				for (unsigned i = 0; i < data.size(); ++i) {
+					double y = p.nominal[i];
+					for (auto& s : p.shapes) y += morph(par[s.par], s.plus[i], s.minus[i]);
+					dot += r[i]*y;
+				}
+				if (p.signal) gradient[0] += norm_nuisance*dot;
+				for (auto& n : p.norms) gradient[n.first] += norm*n.second*dot;
+				for (auto& s : p.shapes) {
+					double d = 0;
+					for (unsigned i = 0; i < data.size(); ++i) d += r[i]*morph_derivative(par[s.par], s.plus[i], s.minus[i]);
+					gradient[s.par] += norm*d;
+				}
+			}
+		}
+
+		double fit(ROOT::Math::Minimizer* minimizer, vector<double>& par, bool fix_mu) const {
+			// Minimize over the nuisance parameters (and beta_signal >= 0, unless "fix_mu"), starting from "par":
+			minimizer->Clear();
+			minimizer->SetFunction(*this);
+			if (fix_mu) minimizer->SetFixedVariable(0, "beta_signal", par[0]);
+			else minimizer->SetLowerLimitedVariable(0, "beta_signal", par[0], max(0.1*par[0], 1e-4), 0);
+			for (unsigned k = 1; k < NDim(); ++k) minimizer->SetVariable(k, names[k].Data(), par[k], 0.1);
+			minimizer->Minimize();
+			for (unsigned k = 0; k < NDim(); ++k) par[k] = minimizer->X()[k];
+			return minimizer->MinValue();
+		}
+
+		static double morph(double t, double plus, double minus) {
+			if (t > 1) return t*plus;
+			if (t < -1) return -t*minus;
+			double t2 = t*t;
+			return t/2*(plus - minus) + (3*t2*t2*t2 - 10*t2*t2 + 15*t2)/16*(plus + minus);
+		}
+		static double morph_derivative(double t, double plus, double minus) {
+			if (t > 1) return plus;
+			if (t < -1) return -minus;
+			double t2 = t*t;
+			return (plus - minus)/2 + (18*t2*t2*t - 40*t2*t + 30*t)/16*(plus + minus);
+		}
+
+	private:
+		double DoEval(const double* par) const override {
+			vector<double> gradient(NDim());
+			double value;
+			FdF(par, value, &gradient[0]);
+			return value;
+		}
+		double DoDerivative(const double* par, unsigned int i) const override {
+			vector<double> gradient(NDim());
+			double value;
+			FdF(par, value, &gradient[0]);
+			return gradient[i];
+		}
+};
+
+class cls_engine {
+	public:
+		struct limit {
+			TString signal;
+			double mass, observed, expected[5];      // expected: -2, -1, 0, +1, +2 sigma
+			vector<double> toys;
+		};
+
+		double cl = 0.95;
+		TString observable = "mavg";
+		vector<limit> limits;
+
+		cls_engine(TString f_in) {
+			// Read the processes and their shape variations:
+			TFile* tf_in = TFile::Open(f_in);
+			if (!tf_in) {
+				cout << "[!!] ERROR: Couldn't open " << f_in << "." << endl;
+				return;
+			}
+			map<TString, TH1*> hs;
+			TIter next(tf_in->GetListOfKeys());
+			while (TKey* key = (TKey*) next()) {
+				TString name = key->GetName();
+				if (!name.BeginsWith(observable + "__")) continue;
+				hs[name] = (TH1*) key->ReadObj();
+			}
+			names.push_back("beta_signal");
+			for (auto& h : hs) {
+				TString name = h.first(observable.Length() + 2, h.first.Length() - observable.Length() - 2);
+				if (name.Contains("__")) continue;		// A shape variation
+				if (name == "DATA") data = get_contents(h.second);
+				else processes.push_back({name, name.BeginsWith("Ms"), get_contents(h.second), {}, {}});
+			}
+			for (auto& p : processes) {
+				for (auto& h : hs) {
+					TString prefix = observable + "__" + p.name + "__";
+					if (!h.first.BeginsWith(prefix) || !h.first.EndsWith("__plus")) continue;
+					TString nuisance = h.first(prefix.Length(), h.first.Length() - prefix.Length() - 6);
+					TString name_minus = prefix + nuisance + "__minus";
+					if (hs.find(name_minus) == hs.end()) {
+						cout << "[!!] WARNING: " << h.first << " doesn't have a minus variation." << endl;
+						continue;
+					}
+					cls_model::shape s = {parameter(nuisance), get_contents(h.second), get_contents(hs[name_minus])};
+					for (unsigned i = 0; i < s.plus.size(); ++i) {
+						s.plus[i] -= p.nominal[i];
+						s.minus[i] -= p.nominal[i];
+					}
+					p.shapes.push_back(s);
+				}
+			}
+			tf_in->Close();
+			cout << "[OK] Read " << processes.size() << " processes with " << names.size() - 1 << " shape nuisance parameters from " << f_in << "." << endl;
+		}
+
+		void add_lognormal_uncertainty(TString name, double log_kappa, TString process_name) {
+			unsigned par = parameter(name);
+			for (auto& p : processes) {
+				if (p.name == process_name) p.norms.push_back({par, log_kappa});
+			}
+		}
+
+		void run(TString name, int n_toys=0, unsigned n_threads=0, unsigned seed=0) {
+			// Calculate the limits of every signal and write "expected_<name>.txt" and "observed_<name>.txt":
+			TStopwatch timer;
+			limits.clear();
+			vector<cls_model> models;
+			for (auto& p : processes) {
+				if (!p.signal) continue;
+				cls_model model;
+				model.names = names;
+				for (auto& q : processes) {
+					if (!q.signal || q.name == p.name) model.processes.push_back(q);
+				}
+				model.data = data.empty() ? vector<double>(p.nominal.size(), 0) : data;
+				models.push_back(model);
+				limit l = {p.name, TString(p.name(2, p.name.Length() - 2)).Atof(), -1, {-1, -1, -1, -1, -1}, vector<double>(max(n_toys, 0), -1)};
+				limits.push_back(l);
+			}
+
+			// Run the tasks (one per signal, and one per toy) in parallel, with a minimizer per thread:
+			vector<pair<unsigned, int>> tasks;      // (signal, toy or -1)
+			for (unsigned i = 0; i < models.size(); ++i) {
+				tasks.push_back({i, -1});
+				for (int t = 0; t < n_toys; ++t) tasks.push_back({i, t});
+			}
+			ROOT::EnableThreadSafety();
+			if (n_threads == 0) n_threads = max(1u, thread::hardware_concurrency());
+			n_threads = min<unsigned>(n_threads, tasks.size());
+			vector<ROOT::Math::Minimizer*> minimizers;
+			for (unsigned t = 0; t < n_threads; ++t) {
+				minimizers.push_back(ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad"));
+				minimizers.back()->SetPrintLevel(-1);
+			}
+			atomic<unsigned> next(0);
+			vector<thread> threads;
+			for (unsigned t = 0; t < n_threads; ++t) {
+				threads.push_back(thread([&, t]() {
+					for (unsigned i = next++; i < tasks.size(); i = next++) {
+						cls_model model = models[tasks[i].first];
+						limit& l = limits[tasks[i].first];
+						if (tasks[i].second < 0) run_asymptotic(model, minimizers[t], l, !data.empty());
+						else l.toys[tasks[i].second] = run_toy(model, minimizers[t], seed + n_toys*tasks[i].first + tasks[i].second);
+					}
+				}));
+			}
+			for (auto& t : threads) t.join();
+			for (auto m : minimizers) delete m;
+
+			// Toy bands:
+			if (n_toys > 0) {
+				vector<double> ps = {TMath::Freq(-2), TMath::Freq(-1), 0.5, TMath::Freq(1), TMath::Freq(2)};
+				for (auto& l : limits) {
+					vector<double> toys = l.toys;
+					sort(toys.begin(), toys.end());
+					for (unsigned j = 0; j < ps.size(); ++j) l.expected[j] = toys[min<unsigned>(ps[j]*toys.size(), toys.size() - 1)];
+				}
+			}
+			sort(limits.begin(), limits.end(), [](const limit& a, const limit& b) {return a.mass < b.mass;});
+
+			// Write the limits like theta's "write_txt" (the 2-sigma band, then the 1-sigma band):
+			ofstream f_expected("expected_" + string(name.Data()) + ".txt");
+			f_expected << "# x; y; band 0 low; band 0 high; band 1 low; band 1 high" << endl;
+			for (auto& l : limits) f_expected << l.mass << " " << l.expected[2] << " " << l.expected[0] << " " << l.expected[4] << " " << l.expected[1] << " " << l.expected[3] << endl;
+			f_expected.close();
+			if (!data.empty()) {
+				ofstream f_observed("observed_" + string(name.Data()) + ".txt");
+				f_observed << "# x; y; yerror" << endl;
+				for (auto& l : limits) f_observed << l.mass << " " << l.observed << " " << 0 << endl;
+				f_observed.close();
+			}
+			for (auto& l : limits) cout << "\t" << l.signal << ": observed " << l.observed << ", expected " << l.expected[2] << " [" << l.expected[1] << ", " << l.expected[3] << "]" << endl;
+			cout << "[OK] Calculated " << limits.size() << " limits in " << timer.RealTime() << " s." << endl;
+		}
+
+	private:
+		vector<TString> names;
+		vector<cls_model::process> processes;
+		vector<double> data;
+
+		void run_asymptotic(cls_model& model, ROOT::Math::Minimizer* minimizer, limit& l, bool with_data) const {
+			double alpha = 1 - cl;
+
+			// The background-only Asimov dataset, with the nuisance parameters from a background-only fit to the data:
+			vector<double> par_b(model.NDim(), 0);
+			if (with_data) model.fit(minimizer, par_b, true);
+			cls_model asimov = model;
+			asimov.expected(&par_b[0], asimov.data);
+			vector<double> par_a = par_b;
+			double nll_a = asimov.fit(minimizer, par_a, true);
+			auto q_asimov = [&](double mu) {
+				vector<double> par = par_b;
+				par[0] = mu;
+				return max(2*(asimov.fit(minimizer, par, true) - nll_a), 0.0);
+			};
+
+			// Expected limits: mu_N = sigma*(Phi^-1(1 - alpha*Phi(N)) + N), with sigma = mu/sqrt(q_mu,A) near the median limit:
+			double s = 0, b = 0;
+			for (auto& p : model.processes) {
+				for (double y : p.nominal) (p.signal ? s : b) += y;
+			}
+			double mu = s > 0 ? 2*sqrt(max(b, 1.0))/s : 1;
+			double sigma = mu;
+			for (int i = 0; i < 5; ++i) {
+				double q = q_asimov(mu);
+				if (q <= 0) break;
+				sigma = mu/sqrt(q);
+				mu = sigma*TMath::NormQuantile(1 - alpha/2);
+			}
+			for (int n = -2; n <= 2; ++n) l.expected[n + 2] = sigma*(TMath::NormQuantile(1 - alpha*TMath::Freq(n)) + n);
+			if (!with_data) return;
+
+			// Observed limit: the beta_signal with CLs = (1 - Phi(sqrt(q))) / Phi(sqrt(q_A) - sqrt(q)) = alpha:
+			vector<double> par_hat = par_b;
+			double nll_hat = model.fit(minimizer, par_hat, false);
+			double mu_hat = par_hat[0];
+			auto cls = [&](double mu) {
+				double q = 0;
+				if (mu > mu_hat) {
+					vector<double> par = par_hat;
+					par[0] = mu;
+					q = max(2*(model.fit(minimizer, par, true) - nll_hat), 0.0);
+				}
+				double q_a = q_asimov(mu);
+				double clb = TMath::Freq(sqrt(q_a) - sqrt(q));
+				return clb > 0 ? (1 - TMath::Freq(sqrt(q)))/clb : 0.0;
+			};
+			double lo = mu_hat, hi = max(l.expected[2], 2*mu_hat);
+			for (int i = 0; i < 30 && cls(hi) > alpha; ++i) {
+				lo = hi;
+				hi *= 2;
+			}
+			for (int i = 0; i < 40 && hi - lo > 1e-4*hi; ++i) {
+				double mid = (lo + hi)/2;
+				if (cls(mid) > alpha) lo = mid;
+				else hi = mid;
+			}
+			l.observed = (lo + hi)/2;
+		}
+
+		double run_toy(cls_model model, ROOT::Math::Minimizer* minimizer, unsigned seed) const {
+			// The observed limit of a background-only toy, with the nuisance parameters drawn from their constraints:
+			TRandom3 random(seed + 1);
+			vector<double> par(model.NDim(), 0);
+			for (unsigned k = 1; k < par.size(); ++k) par[k] = random.Gaus();
+			vector<double> lambda;
+			model.expected(&par[0], lambda);
+			for (unsigned i = 0; i < lambda.size(); ++i) model.data[i] = random.Poisson(max(lambda[i], 0.0));
+			limit l;
+			run_asymptotic(model, minimizer, l, true);
+			return l.observed;
+		}
+
+		unsigned parameter(TString name) {
+			for (unsigned k = 0; k < names.size(); ++k) {
+				if (names[k] == name) return k;
+			}
+			names.push_back(name);
+			return names.size() - 1;
+		}
+
+		static vector<double> get_contents(TH1* h) {
+			vector<double> result;
+			for (int i = 1; i <= h->GetNbinsX(); ++i) result.push_back(h->GetBinContent(i));
+			return result;
+		}
+};
+
+#endif
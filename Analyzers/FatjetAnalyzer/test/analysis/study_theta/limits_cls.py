@@ -0,0 +1,57 @@
+####################################################################
+# Type: SCRIPT                                                     #
+#                                                                  #
+# Description: "python limits_cls.py [theta_plots_sig15_sb]" makes #
+#   the "expected_*.txt" and "observed_*.txt" limit files (for     #
+#   "limit_plotter.py") with asymptotic CLs ("cls_engine.cc"),     #
+#   instead of theta's Markov chains ("limits.py").                #
+####################################################################
+
+# IMPORTS:
+import sys
+import math
+from ROOT import gROOT
+# :IMPORTS
+
+# CLASSES:
+# :CLASSES
+
+# VARIABLES:
+n_toys = 0		# 0: expected bands from the Asimov dataset
+n_threads = 0		# 0: one per core
+uncertainties = [		# The lognormal normalization uncertainties of "limits.py"
+	("Normalization_ttbar", math.log(1.2), "TTbar"),
+	("Normalization_qcd", math.log(5.0), "QCD"),
+	("Normalization_ms100", math.log(1.2), "Ms100"),
+	("Normalization_ms150", math.log(1.2), "Ms150"),
+	("Normalization_ms200", math.log(1.2), "Ms200"),
+	("Normalization_ms250", math.log(1.2), "Ms250"),
+	("Normalization_ms300", math.log(1.2), "Ms300"),
+	("Normalization_ms400", math.log(1.2), "Ms400"),
+	("Normalization_ms500", math.log(1.2), "Ms500"),
+]
+# :VARIABLES
+
+# FUNCTIONS:
+def main():
+	INPUTFILE = "theta_plots_sig15_sb"
+	if len(sys.argv) > 1: INPUTFILE = sys.argv[1].replace(".root", "")
+	
+	print "*"*30
+	print "*"," "*4,INPUTFILE," "*(30-10-len(INPUTFILE)),"*"
+	print "*"*30
+	
+	gROOT.SetBatch()
+	gROOT.ProcessLine(".L cls_engine.cc+")
+	from ROOT import cls_engine
+	engine = cls_engine(INPUTFILE + ".root")
+	for name, log_kappa, process in uncertainties:
+		engine.add_lognormal_uncertainty(name, log_kappa, process)
+	engine.run(INPUTFILE.replace("theta_plots_", ""), n_toys, n_threads)
+	return True
+# :FUNCTIONS
+
+# MAIN:
+if __name__ == "__main__":
+	main()
+# :MAIN
@@ -0,0 +1,273 @@
+// trigger_engine: measures trigger efficiencies from the SingleMuon ("cutsmu")
+// tuples in one pass, for many trigger combinations and offline variables.
+//
+// Each trigger ("trig_*" branch) is a bit. An event's trigger bits are read
+// once into a mask, and a combination (an OR of triggers) passes if the mask
+// has any of its bits, so every combination is one AND of two words. Every
+// variable's denominator is filled once per event, and its numerator once per
+// passing combination. The files are read in parallel, each into its own
+// histograms, which are added at the end. A file that doesn't open, or that's
+// missing the tree or one of the triggers, is skipped (a missing trigger would
+// look like one that never fires), and "run" then returns false.
+//
+// For each combination and variable the output has
+//     "total_<var>", "pass_<combo>_<var>": the denominator and numerator
+//     "eff_<combo>_<var>": the TEfficiency (Clopper-Pearson intervals)
+//     "turnon_<combo>_<var>": a fit of p0/2*(1 + erf((x - p1)/p2))
+//     "turnon_<combo>_<var>_params": the plateau, the 50% point, the width,
+//         and the x where the efficiency reaches 99% of the plateau (with errors)
+// It's run by "trigger_plotter.py".
+
+#ifndef TRIGGER_ENGINE
+#define TRIGGER_ENGINE
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+#include "TH1D.h"
+#include "TF1.h"
+#include "TMath.h"
+#include "TEfficiency.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TROOT.h"
+#include "TStopwatch.h"
+
+using namespace std;
+
+class trigger_engine {
+	public:
+		struct combination {TString name; unsigned long long mask;};
+		struct variable {TString key, expression, selection; int n; double lo, hi;};
+
+		TString tree_name = "tuplizer/events";
+		TString denominator = "trig_mupt50[0]&&Sum$(ak8_pf_pt>170&&abs(ak8_pf_eta)<2.5)>=2";
+		vector<TString> triggers;       // Trigger i is bit i
+		vector<combination> combinations;
+		vector<variable> variables;
+		vector<TH1D*> totals;
+		vector<vector<TH1D*>> passes;   // [variable][combination]
+
+		bool add_combination(TString name, TString trigger_list) {
+			// "trigger_list" is a "+"-separated list of trigger branches, like "trig_pfht900+trig_pfpt450".
+			// There can only be 64 triggers and 64 combinations (the bits of the masks); a combination past that isn't added, and false is returned:
+			if (combinations.size() >= 64) {
+				cout << "[!!] ERROR: " << name << " isn't added: there can only be 64 combinations." << endl;
+				return false;
+			}
+			vector<TString> triggers_new = triggers;
+			unsigned long long mask = 0;
+			TObjArray* tokens = trigger_list.Tokenize("+");
+			for (int i = 0; i < tokens->GetEntries(); ++i) {
+				TString trigger = ((TObjString*) tokens->At(i))->GetString();
+				unsigned bit = find(triggers_new.begin(), triggers_new.end(), trigger) - triggers_new.begin();
+				if (bit == triggers_new.size()) {
+					if (bit >= 64) {
+						cout << "[!!] ERROR: " << name << " isn't added: there can only be 64 triggers." << endl;
+						delete tokens;
+						return false;
+					}
+					triggers_new.push_back(trigger);
+				}
+				mask |= 1ULL << bit;
+			}
+			delete tokens;
+			triggers = triggers_new;
+			combinations.push_back({name, mask});
+			return true;
+		}
+
+		void add_variable(TString key, TString expression, int n, double lo, double hi, TString selection="") {
+			// "selection" is an extra requirement for this variable's denominator (like an HT cut for the mass plots):
+			variables.push_back({key, expression, selection, n, lo, hi});
+		}
+
+		bool run(vector<TString> files, unsigned n_threads=0) {
+			TStopwatch timer;
+			totals.clear();
+			passes.clear();
+			for (auto& v : variables) {
+				totals.push_back(book("total_" + v.key, v));
+				passes.push_back({});
+				for (auto& c : combinations) passes.back().push_back(book("pass_" + c.name + "_" + v.key, v));
+			}
+
+			// Read the files in parallel:
+			vector<vector<TH1D*>> thread_totals;
+			vector<vector<vector<TH1D*>>> thread_passes;
+			ROOT::EnableThreadSafety();
+			if (n_threads == 0) n_threads = max(1u, thread::hardware_concurrency());
+			n_threads = max(1u, min<unsigned>(n_threads, files.size()));
+			for (unsigned t = 0; t < n_threads; ++t) {
+				thread_totals.push_back({});
+				thread_passes.push_back({});
+				for (unsigned iv = 0; iv < variables.size(); ++iv) {
+					thread_totals[t].push_back((TH1D*) totals[iv]->Clone(TString::Format("%s_%d", totals[iv]->GetName(), t)));
+					thread_passes[t].push_back({});
+					for (auto h : passes[iv]) thread_passes[t][iv].push_back((TH1D*) h->Clone(TString::Format("%s_%d", h->GetName(), t)));
+				}
+			}
+			atomic<unsigned> next(0);
+			atomic<long long> n_events(0);
+			atomic<unsigned> n_bad(0);
+			vector<thread> threads;
+			for (unsigned t = 0; t < n_threads; ++t) {
+				threads.push_back(thread([&, t]() {
+					for (unsigned i = next++; i < files.size(); i = next++) {
+						long long n = run_file(files[i], thread_totals[t], thread_passes[t]);
+						if (n < 0) n_bad++;
+						else n_events += n;
+					}
+				}));
+			}
+			for (auto& t : threads) t.join();
+			for (unsigned t = 0; t < n_threads; ++t) {
+				for (unsigned iv = 0; iv < variables.size(); ++iv) {
+					totals[iv]->Add(thread_totals[t][iv]);
+					delete thread_totals[t][iv];
+					for (unsigned ic = 0; ic < combinations.size(); ++ic) {
+						passes[iv][ic]->Add(thread_passes[t][iv][ic]);
+						delete thread_passes[t][iv][ic];
+					}
+				}
+			}
+			if (n_bad) {
+				cout << "[!!] ERROR: " << n_bad << " of " << files.size() << " files were skipped (see the errors above)." << endl;
+				return false;
+			}
+			cout << "[OK] Read " << n_events << " events from " << files.size() << " files in " << timer.RealTime() << " s." << endl;
+			return true;
+		}
+
+		void write(TString f_out="trigger_plots.root", bool fit=true) {
+			TFile* tf_out = TFile::Open(f_out, "RECREATE");
+			for (unsigned iv = 0; iv < variables.size(); ++iv) {
+				const variable& v = variables[iv];
+				tf_out->WriteTObject(totals[iv]);
+				for (unsigned ic = 0; ic < combinations.size(); ++ic) {
+					TString name = combinations[ic].name + "_" + v.key;
+					TH1D* h_pass = passes[iv][ic];
+					tf_out->WriteTObject(h_pass);
+					if (!TEfficiency::CheckConsistency(*h_pass, *totals[iv])) {
+						cout << "[!!] WARNING: The efficiency of " << name << " isn't consistent." << endl;
+						continue;
+					}
+					TEfficiency* eff = new TEfficiency(*h_pass, *totals[iv]);
+					eff->SetName("eff_" + name);
+					if (fit) {
+						TF1* turnon = fit_turnon(eff, "turnon_" + name, v);
+						tf_out->WriteTObject(turnon);
+						tf_out->WriteTObject(get_params(turnon, "turnon_" + name + "_params"));
+					}
+					tf_out->WriteTObject(eff);
+				}
+			}
+			tf_out->Close();
+			cout << "[OK] Wrote the efficiencies of " << combinations.size() << " trigger combinations in " << variables.size() << " variables to " << f_out << "." << endl;
+		}
+
+	private:
+		static TH1D* book(TString name, const variable& v) {
+			TH1D* h = new TH1D(name, "", v.n, v.lo, v.hi);
+			h->SetDirectory(0);
+			return h;
+		}
+
+		long long run_file(TString path, vector<TH1D*>& h_totals, vector<vector<TH1D*>>& h_passes) {
+			// Fill the histograms from one file, and return its number of events (or -1 if it can't be read, or it's missing a trigger):
+			TFile* tf_in = TFile::Open(path);
+			if (!tf_in || tf_in->IsZombie()) {
+				cout << "[!!] ERROR: " << path << " doesn't open, so it's skipped." << endl;
+				if (tf_in) delete tf_in;
+				return -1;
+			}
+			TTree* tt = (TTree*) tf_in->Get(tree_name);
+			if (!tt) {
+				cout << "[!!] ERROR: " << path << " doesn't have " << tree_name << ", so it's skipped." << endl;
+				tf_in->Close();
+				return -1;
+			}
+			for (auto& trigger : triggers) {
+				if (!tt->GetBranch(trigger)) {
+					cout << "[!!] ERROR: " << path << " doesn't have " << trigger << ", so it's skipped." << endl;
+					tf_in->Close();
+					return -1;
+				}
+			}
+			TTreeFormula* f_den = new TTreeFormula("den", denominator, tt);
+			vector<TTreeFormula*> f_trig;
+			for (auto& trigger : triggers) f_trig.push_back(new TTreeFormula(trigger, trigger + "[0]", tt));
+			vector<TTreeFormula*> f_var, f_sel;
+			for (auto& v : variables) {
+				f_var.push_back(new TTreeFormula(v.key, v.expression, tt));
+				f_sel.push_back(v.selection != "" ? new TTreeFormula(v.key + "_sel", v.selection, tt) : 0);
+			}
+
+			Long64_t n = tt->GetEntries();
+			for (Long64_t i = 0; i < n; ++i) {
+				tt->LoadTree(i);		// The formulas read only the branches that they need.
+				if (f_den->GetNdata() == 0 || f_den->EvalInstance() == 0) continue;
+				unsigned long long bits = 0;
+				for (unsigned j = 0; j < f_trig.size(); ++j) {
+					if (f_trig[j]->GetNdata() && f_trig[j]->EvalInstance() != 0) bits |= 1ULL << j;
+				}
+				unsigned long long passed = 0;      // Bit c: combination c passed
+				for (unsigned c = 0; c < combinations.size(); ++c) passed |= (unsigned long long) ((bits & combinations[c].mask) != 0) << c;
+				for (unsigned iv = 0; iv < f_var.size(); ++iv) {
+					if (f_sel[iv] && (f_sel[iv]->GetNdata() == 0 || f_sel[iv]->EvalInstance() == 0)) continue;
+					if (f_var[iv]->GetNdata() == 0) continue;
+					double x = f_var[iv]->EvalInstance();
+					h_totals[iv]->Fill(x);
+					for (unsigned long long p = passed; p; p &= p - 1) h_passes[iv][__builtin_ctzll(p)]->Fill(x);
+				}
+			}
+			delete f_den;
+			for (auto f : f_trig) delete f;
+			for (auto f : f_var) delete f;
+			for (auto f : f_sel) delete f;
+			tf_in->Close();
+			return n;
+		}
+
+		static TF1* fit_turnon(TEfficiency* eff, TString name, const variable& v) {
+			TF1* turnon = new TF1(name, "[0]/2*(1 + TMath::Erf((x - [1])/[2]))", v.lo, v.hi);
+			// Start from the first bin above 50%:
+			TH1* h_total = eff->GetCopyTotalHisto();
+			double x50 = (v.lo + v.hi)/2;
+			for (int i = 1; i <= v.n; ++i) {
+				if (eff->GetEfficiency(i) > 0.5) {
+					x50 = h_total->GetBinCenter(i);
+					break;
+				}
+			}
+			delete h_total;
+			turnon->SetParameters(vector<double>({1.0, x50, (v.hi - v.lo)/10}).data());
+			turnon->SetParLimits(0, 0, 1);
+			turnon->SetParLimits(2, 1e-3*(v.hi - v.lo), v.hi - v.lo);
+			eff->Fit(turnon, "QR");
+			return turnon;
+		}
+
+		static TH1D* get_params(TF1* turnon, TString name) {
+			TH1D* params = new TH1D(name, "", 4, 0, 4);
+			params->SetDirectory(0);
+			for (int i = 0; i < 3; ++i) {
+				params->SetBinContent(i + 1, turnon->GetParameter(i));
+				params->SetBinError(i + 1, turnon->GetParError(i));
+			}
+			// 99% of the plateau: erf((x - p1)/p2) = 0.98
+			double z = TMath::ErfInverse(0.98);
+			params->SetBinContent(4, turnon->GetParameter(1) + z*turnon->GetParameter(2));
+			params->SetBinError(4, sqrt(pow(turnon->GetParError(1), 2) + pow(z*turnon->GetParError(2), 2)));
+			return params;
+		}
+};
+
+#endif
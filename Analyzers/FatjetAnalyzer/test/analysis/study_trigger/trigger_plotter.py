@@ -0,0 +1,70 @@
+####################################################################
+# Type: SCRIPT                                                     #
+#                                                                  #
+# Description: "python trigger_plotter.py [directory ...]" makes   #
+#   "trigger_plots.root": the efficiencies of the trigger          #
+#   combinations below in HT and the jet masses, from one pass     #
+#   over the SingleMuon ("cutsmu") tuples ("trigger_engine.cc").   #
+####################################################################
+
+# IMPORTS:
+import sys, os
+from ROOT import gROOT, vector, TString
+# :IMPORTS
+
+# CLASSES:
+# :CLASSES
+
+# VARIABLES:
+paths = [
+	"/cms/tote/store/SingleMuon/tuple_smu16e_feb17_cutsmu/180114_201241/0000",
+	"/cms/tote/store/SingleMuon/tuple_smu16e_feb17_cutsmu/180114_201241/0001",
+	"/cms/tote/store/SingleMuon/tuple_smu16f_feb17_cutsmu/180113_181439",
+]
+n_threads = 0		# 0: one per core
+
+combinations = [		# (name, triggers)
+	("ht900", ["trig_pfht900"]),
+	("ak8ht700", ["trig_pfak8ht700mt50"]),
+	("pt450", ["trig_pfpt450"]),
+	("ak8pt360", ["trig_pfak8pt360mt30"]),
+	("ht4j", ["trig_pfht750pt50x4", "trig_pfht750pt70x4", "trig_pfht800pt50x4"]),
+	("analysis", ["trig_pfht900", "trig_pfak8ht700mt50", "trig_pfpt450", "trig_pfak8pt360mt30", "trig_pfak8pt280pt200mt30csv20"]),
+	("analysisxcsv", ["trig_pfht900", "trig_pfak8ht700mt50", "trig_pfpt450", "trig_pfak8pt360mt30"]),
+]
+
+htak8 = "Sum$(ak8_pf_pt/ak8_pf_jec*(ak8_pf_pt/ak8_pf_jec>150&&abs(ak8_pf_eta)<2.5))"		# (The anatuple's "htak8")
+variables = [		# (key, expression, bins, low, high, selection)
+	("htak8", htak8, 40, 0, 2000, ""),
+	("mp0ht850", "ca12_pf_mp[0]", 50, 0, 500, htak8 + ">850"),
+	("mp0ht900", "ca12_pf_mp[0]", 50, 0, 500, htak8 + ">900"),
+	("mavgpht850", "(ca12_pf_mp[0]+ca12_pf_mp[1])/2", 50, 0, 500, htak8 + ">850&&Length$(ca12_pf_mp)>1"),
+	("mavgpht900", "(ca12_pf_mp[0]+ca12_pf_mp[1])/2", 50, 0, 500, htak8 + ">900&&Length$(ca12_pf_mp)>1"),
+]
+# :VARIABLES
+
+# FUNCTIONS:
+def main():
+	dirs = sys.argv[1:] if len(sys.argv) > 1 else paths
+	files = vector(TString)()
+	for d in dirs:
+		for f in sorted(os.listdir(d)):
+			if f.endswith(".root"): files.push_back(TString(os.path.join(d, f)))
+	print "[..] Measuring {} trigger combinations in {} files.".format(len(combinations), files.size())
+	
+	gROOT.SetBatch()
+	gROOT.ProcessLine(".L trigger_engine.cc+")
+	from ROOT import trigger_engine
+	engine = trigger_engine()
+	for name, triggers in combinations:
+		if not engine.add_combination(name, "+".join(triggers)): return False
+	for key, expression, n, lo, hi, selection in variables: engine.add_variable(key, expression, n, lo, hi, selection)
+	if not engine.run(files, n_threads): return False
+	engine.write("trigger_plots.root")
+	return True
+# :FUNCTIONS
+
+# MAIN:
+if __name__ == "__main__":
+	main()
+# :MAIN
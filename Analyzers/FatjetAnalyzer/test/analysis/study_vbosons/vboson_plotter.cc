@@ -1,16 +1,17 @@
 #include <Deracination/Straphanger/test/decortication/macros/common.cc>
+#include <Analyzers/FatjetAnalyzer/test/analysis/histogram_cache.cc>
 
-void plot(TFile* tf_out, TTree* tt) {
+vector<int> request_plots(histogram_cache& cache, TTree* tt) {
 	vector<TString> cuts = {"sig", "sb", "sbb"};
 	TString name = tt->GetName();
+	vector<int> plots;
 	for(unsigned icut = 0; icut < cuts.size(); ++icut) {
 		TString cut = cuts[icut];
 		cout << tt->GetName() << " " << cut << endl;
 		TString hname = name + "_" + cut;
-		tt->Draw("mavg_p>>" + hname + "(1200, 0, 1200)", get_cut("fjp_" + cut));
-		TH1* h = (TH1*) gDirectory->Get(hname);
-		tf_out->WriteTObject(h);
+		plots.push_back(cache.request(tt, hname, "mavg_p", get_cut("fjp_" + cut), 1200, 0, 1200));
 	}
+	return plots;
 }
 
 void vboson_plotter() {
@@ -21,12 +22,16 @@ void vboson_plotter() {
 	TFile* tf_in_other = get_ana("bosons");
 	TFile* tf_out = new TFile("vboson_plots.root", "recreate");
 	
-	plot(tf_out, (TTree*) tf_in_wz->Get("wjets"));
-	plot(tf_out, (TTree*) tf_in_wz->Get("zjets"));
-	plot(tf_out, (TTree*) tf_in_other->Get("wwto4q"));
-	plot(tf_out, (TTree*) tf_in_other->Get("wwto2l2q"));
-	plot(tf_out, (TTree*) tf_in_other->Get("zzto4q"));
-	plot(tf_out, (TTree*) tf_in_other->Get("zzto2l2q"));
+	/// (Plots that are already in "histogram_cache.root" aren't remade, and the rest are made from one loop over each tree.)
+	histogram_cache cache;
+	vector<int> plots;
+	for (TTree* tt : {(TTree*) tf_in_wz->Get("wjets"), (TTree*) tf_in_wz->Get("zjets"), (TTree*) tf_in_other->Get("wwto4q"), (TTree*) tf_in_other->Get("wwto2l2q"), (TTree*) tf_in_other->Get("zzto4q"), (TTree*) tf_in_other->Get("zzto2l2q")}) {
+		vector<int> plots_tree = request_plots(cache, tt);
+		plots.insert(plots.end(), plots_tree.begin(), plots_tree.end());
+	}
+	cache.fill();
+	
+	for (int i : plots) tf_out->WriteTObject(cache.at(i));
 }
 
 
@@ -0,0 +1,111 @@
+// template_variations: makes the nominal template and all of its systematic
+// variations from one CDF.
+//
+// A template with amplitude a, shift s and stretch k is, in a bin [lo, hi),
+//     a*(F(u(hi)) - F(u(lo))),  with  u(x) = median + (x - median - s)/k,
+// where F is the CDF interpolated with a monotone cubic (see "cdf_fitter.cc").
+// Each variation (a parameter moved by n sigma) is one evaluation of F at the
+// output bin edges. The edges are already the rebinned ones, so there's no
+// fine histogram to fill and rebin for each variation. Any n can be asked for,
+// so finer scans (like +/-0.5 or +/-2 sigma) cost the same as +/-1 sigma.
+//
+// The histograms are named like theta expects,
+//     "<fullname>" and "<fullname>__<parameter>__plus/minus",
+// and other values of n get the size of the variation added, like
+// "<fullname>__shiftQCD__plus2" or "<fullname>__shiftQCD__minus0p5".
+// Usage:
+//     template_variations v(h_cdf, h_fjp, nrebin);
+//     v.add("shift", "shiftQCD", 20.0);
+//     v.add("stretch", "stretchQCD", 0.16);
+//     v.write(tf_out, "mavg__QCD");           // Nominal and +/-1 sigma
+
+#ifndef TEMPLATE_VARIATIONS
+#define TEMPLATE_VARIATIONS
+
+#include <Analyzers/FatjetAnalyzer/test/analysis/cdf_fitter.cc>		// "monotone_cdf"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "TString.h"
+#include "TDirectory.h"
+#include "TH1.h"
+#include "TH1F.h"
+
+using namespace std;
+
+class template_variations {
+	public:
+		struct variation {
+			TString name;       // The nuisance parameter, like "shiftQCD"
+			int par;            // 0: amplitude, 1: shift, 2: stretch
+			double sigma;
+		};
+
+		monotone_cdf cdf;
+		vector<double> edges;
+		double nominal[3];
+		vector<variation> variations;
+
+		template_variations(TH1* h_cdf, TH1* h_binning, int nrebin=1, double amp=1, double shift=0, double stretch=1) : cdf(h_cdf, true) {
+			// The output binning is "h_binning" rebinned like "TH1::Rebin(nrebin)" (a remainder of bins is dropped):
+			int n = h_binning->GetNbinsX()/max(nrebin, 1);
+			for (int i = 0; i <= n; ++i) edges.push_back(h_binning->GetBinLowEdge(1 + i*max(nrebin, 1)));
+			nominal[0] = amp;
+			nominal[1] = shift;
+			nominal[2] = stretch;
+		}
+
+		void add(TString kind, TString name, double sigma) {
+			// "kind" is "amp", "shift", or "stretch":
+			int par = kind == "amp" ? 0 : (kind == "shift" ? 1 : (kind == "stretch" ? 2 : -1));
+			if (par < 0) {
+				cout << "[!!] ERROR: " << kind << " isn't a template parameter." << endl;
+				return;
+			}
+			variations.push_back({name, par, sigma});
+		}
+
+		TH1F* make(TString name, const double* par) const {
+			// The template with (amplitude, shift, stretch) = "par":
+			double stretch = max(par[2], 1e-3);		// (A large negative variation mustn't flip the template.)
+			vector<double> u(edges.size()), F, f;
+			for (unsigned i = 0; i < edges.size(); ++i) u[i] = cdf.median + (edges[i] - cdf.median - par[1])/stretch;
+			cdf.eval(u, F, f);
+			TH1F* h = new TH1F(name, "", edges.size() - 1, &edges[0]);
+			h->SetDirectory(0);
+			for (unsigned i = 0; i + 1 < edges.size(); ++i) h->SetBinContent(i + 1, par[0]*(F[i + 1] - F[i]));
+			return h;
+		}
+
+		vector<TH1F*> make_all(TString fullname, vector<double> ns={1}) const {
+			// The nominal template, then each variation at +n and -n sigma for each n in "ns":
+			vector<TH1F*> result = {make(fullname, nominal)};
+			for (auto& v : variations) {
+				for (double n : ns) {
+					for (double sign : {1, -1}) {
+						double par[3] = {nominal[0], nominal[1], nominal[2]};
+						par[v.par] += sign*n*v.sigma;
+						result.push_back(make(fullname + "__" + v.name + "__" + suffix(sign, n), par));
+					}
+				}
+			}
+			return result;
+		}
+
+		void write(TDirectory* tf_out, TString fullname, vector<double> ns={1}) const {
+			for (auto h : make_all(fullname, ns)) {
+				tf_out->WriteTObject(h);
+				delete h;
+			}
+		}
+
+		static TString suffix(double sign, double n) {
+			TString result = sign > 0 ? "plus" : "minus";
+			if (n == 1) return result;
+			TString size = TString::Format("%g", n);
+			size.ReplaceAll(".", "p");
+			return result + size;
+		}
+};
+
+#endif
@@ -0,0 +1,18 @@
+#!/bin/bash
+# Runs the same tuplizer job with 1, 2, 4 and 8 threads and prints the wall time and speedup of each.
+# Usage: ./run_thread_scan.sh [maxEvents] [extra tuplizer_cfg.py arguments ...]
+
+nevents=${1:-2000}
+shift
+mkdir -p logs
+
+t1=""
+echo -e "threads\twall [s]\tspeedup"
+for n in 1 2 4 8; do
+	start=$(date +%s.%N)
+	cmsRun tuplizer_cfg.py maxEvents=$nevents numberOfThreads=$n subprocess="ttbarhg" generation="moriond17" suffix="cutpt300eta20" data=False crab=False outFile="tuple_threads$n.root" "$@" > logs/thread_scan_$n.log 2>&1
+	end=$(date +%s.%N)
+	t=$(echo "$end - $start" | bc)
+	if [ -z "$t1" ]; then t1=$t; fi
+	echo -e "$n\t$t\t$(echo "scale=2; $t1/$t" | bc)"
+done
@@ -1,13 +1,19 @@
 ####################################################################
 # Type: SCRIPT                                                     #
 #                                                                  #
-# Description: [description]                                       #
+# Description: Combines tuple files into groups of "n_group", with #
+#   the groups merged in parallel. "python tuple_combine.py" does  #
+#   the processes of "ds_generation"; "python tuple_combine.py     #
+#   <out_dir> <file or directory> ..." does local files. Each      #
+#   input is checked first (it opens, it has "tree", and the tree  #
+#   has entries), and bad ones are skipped and listed in           #
+#   "<out_dir>/tuple_combine_bad.txt".                             #
 ####################################################################
 
 # IMPORTS:
-import sys
-from subprocess import Popen, PIPE
-from decortication import dataset
+import sys, os
+import multiprocessing
+from ROOT import gROOT, TFile, TFileMerger
 # /IMPORTS
 
 # CLASSES:
@@ -15,48 +21,112 @@ from decortication import dataset
 
 # VARIABLES:
 ds_generation = "spring15"
+processes = ["qcdmg"]
 out_dir = "/uscms_data/d3/tote/temp"
+tree = "tuplizer/events"
+n_group = 200		# Input files per output file
+n_workers = 0		# Groups merged at once (0: one per core)
+recluster = "branch"		# Output basket order: "branch" or "entry" (fast basket copying), or "optimize" (rewrite the baskets with optimized sizes; slow)
 # /VARIABLES
 
 # FUNCTIONS:
+def check_file(path):
+	# Return (compression settings, "") for a good input, or (None, reason) for a bad one:
+	tf = TFile.Open(path)
+	if not tf or tf.IsZombie(): return None, "it doesn't open"
+	reason = ""
+	if tf.TestBit(TFile.kRecovered): reason = "it wasn't closed properly"
+	else:
+		tt = tf.Get(tree)
+		if not tt: reason = "it doesn't have {}".format(tree)
+		elif tt.GetEntries() <= 0: reason = "{} is empty".format(tree)
+	compression = tf.GetCompressionSettings()
+	tf.Close()
+	if reason: return None, reason
+	return compression, ""
+
+def merge_group(task):
+	# Check and merge one group of files (this runs in a worker process):
+	out_file, group = task
+	gROOT.SetBatch()
+	good, bad, compressions = [], [], []
+	for f in group:
+		compression, reason = check_file(f)
+		if reason: bad.append((f, reason))
+		else:
+			good.append(f)
+			compressions.append(compression)
+	if not good: return out_file, False, bad, None
+
+	# Copy baskets directly when every input has the same compression. The output gets the first good input's compression either way:
+	fast = len(set(compressions)) == 1 and recluster != "optimize"
+	compression = compressions[0]
+	merger = TFileMerger(False, False)
+	merger.SetPrintLevel(0)
+	merger.SetFastMethod(fast)
+	if fast: merger.SetMergeOptions("SortBasketsByEntry" if recluster == "entry" else "SortBasketsByBranch")
+	merger.OutputFile(out_file, "RECREATE", compression)
+	for f in good: merger.AddFile(f, False)
+	return out_file, merger.Merge(), bad, compression
+
+def combine(process, files, out_dir):
+	# Merge the files of one process in groups, with the groups in parallel:
+	groups = [files[i:i+n_group] for i in xrange(0, len(files), n_group)]
+	if not groups:
+		print "[!!] There were no tuple files to combine for {}.".format(process)
+		return []
+	tasks = [("{}/{}_tuple_{}.root".format(out_dir, process, i), group) for i, group in enumerate(groups)]
+	workers = n_workers if n_workers > 0 else multiprocessing.cpu_count()
+	workers = min(workers, len(tasks))
+	print "[..] Combining {} files of {} into {} files with {} workers.".format(len(files), process, len(tasks), workers)
+	if workers == 1: results = [merge_group(task) for task in tasks]
+	else:
+		pool = multiprocessing.Pool(workers)
+		results = pool.map(merge_group, tasks)
+		pool.close()
+		pool.join()
+
+	bad = []
+	for out_file, ok, bad_group, compression in results:
+		bad += bad_group
+		if ok: print "[OK] {} (compression {})".format(out_file, compression)
+		else: print "[!!] ERROR: Making {} failed.".format(out_file)
+	return bad
+
+def report(bad, out_dir):
+	if not bad: return
+	print "[!!] Skipped {} bad files:".format(len(bad))
+	for f, reason in bad: print "\t{}: {}".format(f, reason)
+	with open(os.path.join(out_dir, "tuple_combine_bad.txt"), "w") as out:
+		out.write("".join("{}\t{}\n".format(f, reason) for f, reason in bad))
+
 def main():
+	# Local files:
+	if len(sys.argv) > 2:
+		local_dir = sys.argv[1]
+		files = []
+		for path in sys.argv[2:]:
+			if os.path.isdir(path): files += [os.path.join(path, f) for f in sorted(os.listdir(path)) if f.endswith(".root")]
+			else: files.append(path)
+		report(combine("local", files, local_dir), local_dir)
+		return True
+
+	# Datasets:
+	from decortication import dataset
 	result = dataset.get_datasets(generation=ds_generation, set_info=True)
-	result = {k: v for k, v in result.iteritems() if k == "qcdmg"}
+	result = {k: v for k, v in result.iteritems() if k in processes}
+	bad = []
 	for process, dss in result.iteritems():
-		print process
-		
 		files = []
 		for ds in dss:
 			if ds.tuple_path:
-				files += ds.tuple_path
-		
-		n = 200
-		groups = [files[i:i+n] for i in xrange(0, len(files), n)]
-		if len(groups) > 500:
-			print "ERROR: So many files!"
-			sys.exit()
-		if groups:
-			for i, group in enumerate(groups):
-				print i, len(group)
-				if i > 21: #in [14, 19]:
-					out_file = "{}/{}_tuple_{}.root".format(out_dir, process, i)
-					cmd = "hadd -f {}".format(out_file)            # "-f" forces overwrite of output file.
-					for f in group:
-						if "_1405.root" not in f and "_1323.root" not in f and "_1443.root" not in f and "_1199.root" not in f and "_1464.root" not in f:
-							cmd += " root://cmseos.fnal.gov/{}".format(f)
-					raw_output = Popen([cmd], shell=True, stdout=PIPE, stderr=PIPE).communicate()
-					if raw_output[1]:
-						print raw_output[0]
-						print raw_output[1]
-						sys.exit()
-					else:
-						print out_file
-		else:
-			print "There were no tuple files to combine."
+				files += ["root://cmseos.fnal.gov/" + f if f.startswith("/store") else f for f in ds.tuple_path]
+		bad += combine(process, files, out_dir)
+	report(bad, out_dir)
+	return True
 # /FUNCTIONS
 
 # MAIN:
 if __name__ == "__main__":
 	main()
 # /MAIN
-
@@ -18,6 +18,7 @@ from Configuration.AlCa.autoCond import autoCond          # For automatically de
 ## Custom:
 from decortication import dataset
 from truculence import cmssw
+from Filters.JetFilter.jetFilter_cfi import *
 # /IMPORTS
 
 # FUNCTIONS:
@@ -104,6 +105,30 @@ options.register ('inFile',
 	"Input file(s)"
 )
 options.maxEvents = -1
+options.register ('pum',
+	'chs',
+	VarParsing.multiplicity.singleton,
+	VarParsing.varType.string,
+	"Pileup mitigation to use for the JetWorkshop collections (chs or sk)."
+)
+options.register ('tauProducer',
+	'njettiness',
+	VarParsing.multiplicity.singleton,
+	VarParsing.varType.string,
+	"Module that computes the taus (njettiness, nsubjettiness, or compare; see \"add_tau_variables\")."
+)
+options.register ('numberOfThreads',
+	1,
+	VarParsing.multiplicity.singleton,
+	VarParsing.varType.int,
+	"Number of threads cmsRun uses."
+)
+options.register ('numberOfStreams',
+	0,
+	VarParsing.multiplicity.singleton,
+	VarParsing.varType.int,
+	"Number of concurrent events (streams). The default (0) is one per thread."
+)
 ### Filter options:
 options.register ('cutPtFilter',
 	300,
@@ -123,6 +148,18 @@ options.register ('cutSmuFilter',
 	VarParsing.varType.bool,
 	"Cut based on the single-muon pT > 50 GeV trigger."
 )
+options.register ('cutPtPrefilter',
+	0,
+	VarParsing.multiplicity.singleton,
+	VarParsing.varType.float,
+	"Looser cut on the pT of the two leading miniAOD AK8 jets, applied before any jets are made. The default (0) turns it off; -1 is 2/3 of cutPtFilter. Its efficiency relative to the CA12 filter hasn't been measured yet."
+)
+options.register ('cutHtPrefilter',
+	-1,
+	VarParsing.multiplicity.singleton,
+	VarParsing.varType.float,
+	"Cut on the miniAOD AK4 HT, applied before any jets are made. The default (-1) turns it off."
+)
 ### Tuplizer options:
 options.register ('cutPtTuplizer',
 	20,
@@ -207,8 +244,10 @@ if options.maxEvents > 1000 or options.maxEvents < 0:
 process.options = cms.untracked.PSet(
 	wantSummary=cms.untracked.bool(False),		# Turn off long summary after job.
 	allowUnscheduled=cms.untracked.bool(True),
-	IgnoreCompletely=cms.untracked.vstring('InvalidReference')		# Dangerous.
+	IgnoreCompletely=cms.untracked.vstring('InvalidReference'),		# Dangerous.
 #	SkipEvent=cms.untracked.vstring('ProductNotFound')		# Dangerous.
+	numberOfThreads=cms.untracked.uint32(options.numberOfThreads),
+	numberOfStreams=cms.untracked.uint32(options.numberOfStreams),		# The JetFilter is global and the JetWorkshop producers are stream modules; only the tuplizer sees one event at a time.
 )
 
 ## Input:
@@ -244,9 +283,10 @@ process.out = cms.OutputModule("PoolOutputModule",
 
 ### Add jet collections using the JetWorkshop:
 from Deracination.JetWorkshop.jetWorkshop_cff import add_jet_collection
-add_jet_collection(process, algo_name="ak4", pum_name="chs", groom_names=["p", "f", "s", "t"], data=options.data, taus=range(1,6))
-add_jet_collection(process, algo_name="ak8", pum_name="chs", groom_names=["p", "f", "s", "t"], data=options.data, taus=range(1,6))
-add_jet_collection(process, algo_name="ca12", pum_name="chs", groom_names=["p", "f", "s", "t"], data=options.data, taus=range(1,6))
+pum_title = options.pum.upper()		# As in the JetWorkshop module labels, like "selectedPatJetsCA12CHS".
+add_jet_collection(process, algo_name="ak4", pum_name=options.pum, groom_names=["p", "f", "s", "t"], data=options.data, taus=range(1,6), tau_producer=options.tauProducer)
+add_jet_collection(process, algo_name="ak8", pum_name=options.pum, groom_names=["p", "f", "s", "t"], data=options.data, taus=range(1,6), tau_producer=options.tauProducer)
+add_jet_collection(process, algo_name="ca12", pum_name=options.pum, groom_names=["p", "f", "s", "t"], data=options.data, taus=range(1,6), tau_producer=options.tauProducer)
 
 ### Add jet collections using the JetToolbox:
 #from JMEAnalysis.JetToolbox.jetToolbox_cff import jetToolbox
@@ -296,14 +336,25 @@ process.load("Configuration.StandardSequences.MagneticField_38T_cff")
 
 #print options.cutPtFilter, options.cutEtaFilter
 # Filter:
-process.filter = cms.EDFilter("JetFilter",
-	cut_pt=cms.double(options.cutPtFilter),
-	cut_eta=cms.double(options.cutEtaFilter),
-	cut_smu=cms.bool(options.cutSmuFilter),
-	jetCollection=cms.InputTag("selectedPatJetsCA12CHS"),
-	triggerResults=cms.InputTag("TriggerResults", "", "HLT"),
-	triggerPrescales=cms.InputTag("patTrigger", ""),
-)
+## The filter is a list of stages (see Filters/JetFilter), which it sorts cheapest first.
+process.filter = JetFilter.clone()
+if options.cutSmuFilter:
+	process.filter.stages = cms.VPSet(trigger_stage(["HLT_Mu50_v"], name="smu"))
+else:
+	process.filter.stages = cms.VPSet(jets_stage("selectedPatJetsCA12{}".format(pum_title), pt=options.cutPtFilter, eta=options.cutEtaFilter))
+
+# Prefilter:
+## This runs first and uses jets that are already in the miniAOD, so the JetWorkshop producers (which are unscheduled) never run for events that clearly fail.
+## The AK8 jets are narrower than the CA12 ones, so the cuts are looser than the ones above. (Note that slimmedJetsAK8 only has jets with pT > 170 GeV.)
+if options.cutPtPrefilter < 0:
+	options.cutPtPrefilter = options.cutPtFilter*2/3
+## (The single-muon filter only needs the trigger results, so it doesn't get one.)
+process.prefilter = JetFilter.clone(stages=cms.VPSet())
+if not options.cutSmuFilter:
+	if options.cutPtPrefilter > 0:
+		process.prefilter.stages.append(jets_stage("slimmedJetsAK8", pt=options.cutPtPrefilter, eta=options.cutEtaFilter + 0.5 if options.cutEtaFilter >= 0 else -1))
+	if options.cutHtPrefilter > 0:
+		process.prefilter.stages.append(ht_stage("slimmedJets", ht=options.cutHtPrefilter, pt=30))
 
 #out_location = options.outDir + "/test.root"
 process.TFileService = cms.Service("TFileService",
@@ -328,6 +379,7 @@ process.tuplizer = cms.EDAnalyzer("JetTuplizer",
 	pileup_path=cms.string("pileup_data/"),
 	jec_version_mc=cms.string(jec_path_mc),
 	jec_version_data=cms.string(jec_path_data),
+	pum=cms.string(options.pum),             # JECs for this are used if they exist (otherwise CHS ones are).
 	genInfo=cms.InputTag("generator"),
 	rhoInfo=cms.InputTag("fixedGridRhoFastjetAll"),
 	vertexCollection=cms.InputTag("offlineSlimmedPrimaryVertices"),
@@ -336,27 +388,27 @@ process.tuplizer = cms.EDAnalyzer("JetTuplizer",
 	triggerPrescales=cms.InputTag("patTrigger", ""),
 	## AK4 collections:
 	ak4MAODCollection=cms.InputTag("slimmedJets"),
-	ak4GNCollection=cms.InputTag("selectedPatJetsAK4CHS", "genJets"),
-	ak4PFCollection=cms.InputTag("selectedPatJetsAK4CHS"),
-	ak4PFPrunedCollection=cms.InputTag("selectedPatJetsAK4CHSPruned"),
-	ak4PFTrimmedCollection=cms.InputTag("selectedPatJetsAK4CHSTrimmed"),
-	ak4PFSoftDropCollection=cms.InputTag("selectedPatJetsAK4CHSSoftDrop"),
-	ak4PFFilteredCollection=cms.InputTag("selectedPatJetsAK4CHSFiltered"),
+	ak4GNCollection=cms.InputTag("selectedPatJetsAK4{}".format(pum_title), "genJets"),
+	ak4PFCollection=cms.InputTag("selectedPatJetsAK4{}".format(pum_title)),
+	ak4PFPrunedCollection=cms.InputTag("selectedPatJetsAK4{}Pruned".format(pum_title)),
+	ak4PFTrimmedCollection=cms.InputTag("selectedPatJetsAK4{}Trimmed".format(pum_title)),
+	ak4PFSoftDropCollection=cms.InputTag("selectedPatJetsAK4{}SoftDrop".format(pum_title)),
+	ak4PFFilteredCollection=cms.InputTag("selectedPatJetsAK4{}Filtered".format(pum_title)),
 	## AK8 collections:
 	ak8MAODCollection=cms.InputTag("slimmedJetsAK8"),
-	ak8GNCollection=cms.InputTag("selectedPatJetsAK8CHS", "genJets"),
-	ak8PFCollection=cms.InputTag("selectedPatJetsAK8CHS"),
-	ak8PFPrunedCollection=cms.InputTag("selectedPatJetsAK8CHSPruned"),
-	ak8PFTrimmedCollection=cms.InputTag("selectedPatJetsAK8CHSTrimmed"),
-	ak8PFSoftDropCollection=cms.InputTag("selectedPatJetsAK8CHSSoftDrop"),
-	ak8PFFilteredCollection=cms.InputTag("selectedPatJetsAK8CHSFiltered"),
+	ak8GNCollection=cms.InputTag("selectedPatJetsAK8{}".format(pum_title), "genJets"),
+	ak8PFCollection=cms.InputTag("selectedPatJetsAK8{}".format(pum_title)),
+	ak8PFPrunedCollection=cms.InputTag("selectedPatJetsAK8{}Pruned".format(pum_title)),
+	ak8PFTrimmedCollection=cms.InputTag("selectedPatJetsAK8{}Trimmed".format(pum_title)),
+	ak8PFSoftDropCollection=cms.InputTag("selectedPatJetsAK8{}SoftDrop".format(pum_title)),
+	ak8PFFilteredCollection=cms.InputTag("selectedPatJetsAK8{}Filtered".format(pum_title)),
 	## CA12 collections:
-	ca12GNCollection=cms.InputTag("selectedPatJetsCA12CHS", "genJets"),
-	ca12PFCollection=cms.InputTag("selectedPatJetsCA12CHS"),
-	ca12PFPrunedCollection=cms.InputTag("selectedPatJetsCA12CHSPruned"),
-	ca12PFTrimmedCollection=cms.InputTag("selectedPatJetsCA12CHSTrimmed"),
-	ca12PFSoftDropCollection=cms.InputTag("selectedPatJetsCA12CHSSoftDrop"),
-	ca12PFFilteredCollection=cms.InputTag("selectedPatJetsCA12CHSFiltered"),
+	ca12GNCollection=cms.InputTag("selectedPatJetsCA12{}".format(pum_title), "genJets"),
+	ca12PFCollection=cms.InputTag("selectedPatJetsCA12{}".format(pum_title)),
+	ca12PFPrunedCollection=cms.InputTag("selectedPatJetsCA12{}Pruned".format(pum_title)),
+	ca12PFTrimmedCollection=cms.InputTag("selectedPatJetsCA12{}Trimmed".format(pum_title)),
+	ca12PFSoftDropCollection=cms.InputTag("selectedPatJetsCA12{}SoftDrop".format(pum_title)),
+	ca12PFFilteredCollection=cms.InputTag("selectedPatJetsCA12{}Filtered".format(pum_title)),
 	## Lepton collections:
 	electronCollection=cms.InputTag("slimmedElectrons"),
 	muonCollection=cms.InputTag("slimmedMuons"),
@@ -373,4 +425,10 @@ process.p = cms.Path(
 	process.filter *
 	process.tuplizer
 )
+if len(process.prefilter.stages) > 0:
+	process.p.insert(0, process.prefilter)
+if hasattr(process, "tauChecks"):		# "tauProducer=compare"
+	process.p += process.tauChecks
+	add_filter_summary(process, "prefilter")
+add_filter_summary(process, "filter")
 #process.outpath = cms.EndPath(process.out)
@@ -0,0 +1,67 @@
+#ifndef Deracination_JetWorkshop_ConstituentCache_h
+#define Deracination_JetWorkshop_ConstituentCache_h
+
+// ConstituentCache: read access to the flat constituent products written by
+// the ConstituentProducer. Build one in a module's constructor and call
+// "load" once per event, then ask for the constituents of jet i.
+
+// system include files
+#include <vector>
+
+/// CMSSW includes:
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/ConsumesCollector.h"
+#include "FWCore/Utilities/interface/InputTag.h"
+#include "DataFormats/Common/interface/Handle.h"
+#include <fastjet/PseudoJet.hh>
+
+class ConstituentCache {
+	public:
+		ConstituentCache(const edm::InputTag& tag, edm::ConsumesCollector&& iC) :
+			offsets_(iC.consumes<std::vector<unsigned>>(edm::InputTag(tag.label(), "offsets", tag.process()))),
+			px_(iC.consumes<std::vector<float>>(edm::InputTag(tag.label(), "px", tag.process()))),
+			py_(iC.consumes<std::vector<float>>(edm::InputTag(tag.label(), "py", tag.process()))),
+			pz_(iC.consumes<std::vector<float>>(edm::InputTag(tag.label(), "pz", tag.process()))),
+			e_(iC.consumes<std::vector<float>>(edm::InputTag(tag.label(), "e", tag.process()))),
+			charge_(iC.consumes<std::vector<int>>(edm::InputTag(tag.label(), "charge", tag.process()))),
+			pdgId_(iC.consumes<std::vector<int>>(edm::InputTag(tag.label(), "pdgId", tag.process())))
+		{}
+
+		void load(const edm::Event& iEvent) {
+			iEvent.getByToken(offsets_, offsets);
+			iEvent.getByToken(px_, px);
+			iEvent.getByToken(py_, py);
+			iEvent.getByToken(pz_, pz);
+			iEvent.getByToken(e_, e);
+			iEvent.getByToken(charge_, charge);
+			iEvent.getByToken(pdgId_, pdgId);
+		}
+
+		unsigned n_jets() const {return offsets->size() - 1;}
+		unsigned begin(unsigned ijet) const {return (*offsets)[ijet];}
+		unsigned end(unsigned ijet) const {return (*offsets)[ijet + 1];}
+		unsigned size(unsigned ijet) const {return end(ijet) - begin(ijet);}
+
+		// Constituents of jet "ijet" as PseudoJets (the user index is the position inside the jet):
+		std::vector<fastjet::PseudoJet> get_pseudojets(unsigned ijet) const {
+			std::vector<fastjet::PseudoJet> constituents;
+			constituents.reserve(size(ijet));
+			for (unsigned i = begin(ijet); i < end(ijet); i++) {
+				constituents.push_back(fastjet::PseudoJet((*px)[i], (*py)[i], (*pz)[i], (*e)[i]));
+				constituents.back().set_user_index(i - begin(ijet));
+			}
+			return constituents;
+		}
+
+		// Columns (index with begin(ijet) <= i < end(ijet)):
+		edm::Handle<std::vector<unsigned>> offsets;
+		edm::Handle<std::vector<float>> px, py, pz, e;
+		edm::Handle<std::vector<int>> charge, pdgId;
+
+	private:
+		edm::EDGetTokenT<std::vector<unsigned>> offsets_;
+		edm::EDGetTokenT<std::vector<float>> px_, py_, pz_, e_;
+		edm::EDGetTokenT<std::vector<int>> charge_, pdgId_;
+};
+
+#endif
@@ -0,0 +1,146 @@
+// system include files
+#include <memory>
+#include <iostream>
+
+/// CMSSW includes:
+//// Defaults:
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/StreamID.h"
+//// Custom:
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/JetReco/interface/Jet.h"
+
+// NAMESPACES:
+using namespace std;
+using namespace reco;
+using namespace edm;
+// \NAMESPACES
+
+//
+// class declaration
+//
+
+// The ConstituentProducer walks the constituents of each jet exactly once and
+// writes them out as flat (SoA) vectors, so that downstream producers don't
+// each have to dereference the constituent Ptrs into packedPFCandidates.
+// The constituents of jet i are the entries [offsets[i], offsets[i + 1]) of
+// every other product. Use "ConstituentCache.h" to read the products back.
+class ConstituentProducer : public edm::stream::EDProducer<> {
+   public:
+      explicit ConstituentProducer(const edm::ParameterSet&);
+      ~ConstituentProducer();
+
+      static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+   private:
+      virtual void beginStream(edm::StreamID) override;
+      virtual void produce(edm::Event&, const edm::EventSetup&) override;
+      virtual void endStream() override;
+
+      // Member data:
+      /// Arguments:
+      EDGetTokenT<View<reco::Jet>> src_;
+};
+
+//
+// constructors and destructor
+//
+ConstituentProducer::ConstituentProducer(const edm::ParameterSet& iConfig) :
+	// Consumes statements:
+	src_(consumes<View<reco::Jet>>(iConfig.getParameter<InputTag>("src")))
+{
+	produces<vector<unsigned>>("offsets");
+	produces<vector<float>>("px");
+	produces<vector<float>>("py");
+	produces<vector<float>>("pz");
+	produces<vector<float>>("e");
+	produces<vector<int>>("charge");
+	produces<vector<int>>("pdgId");
+}
+
+
+ConstituentProducer::~ConstituentProducer()
+{
+}
+
+
+//
+// member functions
+//
+
+// ------------ method called to produce the data  ------------
+void
+ConstituentProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+{
+	Handle<View<reco::Jet>> jets;
+	iEvent.getByToken(src_, jets);
+	unsigned nJets = jets->size();
+
+	// Count the constituents first so that every column is allocated once:
+	auto offsets = make_unique<vector<unsigned>>(nJets + 1, 0);
+	for (unsigned ijet=0; ijet < nJets; ijet++) {
+		(*offsets)[ijet + 1] = (*offsets)[ijet] + (*jets)[ijet].numberOfDaughters();
+	}
+	unsigned nConstituents = offsets->back();
+
+	auto px = make_unique<vector<float>>(nConstituents);
+	auto py = make_unique<vector<float>>(nConstituents);
+	auto pz = make_unique<vector<float>>(nConstituents);
+	auto e = make_unique<vector<float>>(nConstituents);
+	auto charge = make_unique<vector<int>>(nConstituents);
+	auto pdgId = make_unique<vector<int>>(nConstituents);
+
+	// Dereference each constituent exactly once:
+	for (unsigned ijet=0; ijet < nJets; ijet++) {
+		const reco::Jet& jet = (*jets)[ijet];
+		unsigned offset = (*offsets)[ijet];
+		for (unsigned idau=0; idau < jet.numberOfDaughters(); idau++) {
+			const reco::Candidate* daughter = jet.daughter(idau);
+			unsigned i = offset + idau;
+			(*px)[i] = daughter->px();
+			(*py)[i] = daughter->py();
+			(*pz)[i] = daughter->pz();
+			(*e)[i] = daughter->energy();
+			(*charge)[i] = daughter->charge();
+			(*pdgId)[i] = daughter->pdgId();
+		}
+	}
+
+	iEvent.put(move(offsets), "offsets");
+	iEvent.put(move(px), "px");
+	iEvent.put(move(py), "py");
+	iEvent.put(move(pz), "pz");
+	iEvent.put(move(e), "e");
+	iEvent.put(move(charge), "charge");
+	iEvent.put(move(pdgId), "pdgId");
+}
+
+
+
+// ------------ method called once each stream before processing any runs, lumis or events  ------------
+void
+ConstituentProducer::beginStream(edm::StreamID)
+{
+}
+
+// ------------ method called once each stream after processing all runs, lumis and events  ------------
+void
+ConstituentProducer::endStream() {
+}
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+ConstituentProducer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  //The following says we do not know what parameters are allowed so do no validation
+  // Please change this to state exactly what you do use, even if it is no parameters
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(ConstituentProducer);
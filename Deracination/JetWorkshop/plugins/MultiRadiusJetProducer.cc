@@ -0,0 +1,172 @@
+// system include files
+#include <memory>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+/// CMSSW includes:
+//// Defaults:
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/StreamID.h"
+//// Custom:
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/JetReco/interface/PFJet.h"
+#include "DataFormats/JetReco/interface/PFJetCollection.h"
+#include "RecoJets/JetProducers/interface/JetSpecific.h"
+#include <fastjet/JetDefinition.hh>
+#include <fastjet/PseudoJet.hh>
+#include <fastjet/ClusterSequence.hh>
+
+// NAMESPACES:
+using namespace std;
+using namespace reco;
+using namespace edm;
+using namespace fastjet;
+// \NAMESPACES
+
+//
+// class declaration
+//
+
+// The MultiRadiusJetProducer makes Cambridge-Aachen PF jet collections for
+// several cone sizes from one clustering. In CA, two pseudojets merge when
+// they're the closest pair and their separation is less than R, so the merging
+// history is ordered in dR and doesn't depend on R. Clustering once at the
+// largest radius and undoing every merge with dR > R therefore gives exactly
+// the CA jets of radius R. Each radius is put into the event with an instance
+// label like "R08" or "R15" (see "radius_label").
+class MultiRadiusJetProducer : public edm::stream::EDProducer<> {
+   public:
+      explicit MultiRadiusJetProducer(const edm::ParameterSet&);
+      ~MultiRadiusJetProducer();
+
+      static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+      static string radius_label(double);
+
+   private:
+      virtual void beginStream(edm::StreamID) override;
+      virtual void produce(edm::Event&, const edm::EventSetup&) override;
+      virtual void endStream() override;
+
+      // Member data:
+      /// Arguments:
+      vector<double> radii_;        // Cone sizes to make collections for
+      double jetPtMin_;             // Minimum jet pT to save
+      EDGetTokenT<View<reco::Candidate>> src_;
+      /// Variables:
+      double r_max;
+      vector<string> labels;
+};
+
+//
+// constructors and destructor
+//
+MultiRadiusJetProducer::MultiRadiusJetProducer(const edm::ParameterSet& iConfig) :
+	radii_(iConfig.getParameter<vector<double>>("radii")),
+	jetPtMin_(iConfig.getParameter<double>("jetPtMin")),
+	// Consumes statements:
+	src_(consumes<View<reco::Candidate>>(iConfig.getParameter<InputTag>("src")))
+{
+	r_max = 0;
+	for (unsigned ir=0; ir < radii_.size(); ir++) {
+		if (radii_[ir] > r_max) r_max = radii_[ir];
+		labels.push_back(radius_label(radii_[ir]));
+		produces<PFJetCollection>(labels.back());
+	}
+}
+
+
+MultiRadiusJetProducer::~MultiRadiusJetProducer()
+{
+}
+
+
+//
+// member functions
+//
+
+string MultiRadiusJetProducer::radius_label(double r) {
+	// 0.8 -> "R08", 1.2 -> "R12", 1.5 -> "R15"
+	stringstream label;
+	label << "R" << setw(2) << setfill('0') << int(r*10 + 0.5);
+	return label.str();
+}
+
+// ------------ method called to produce the data  ------------
+void
+MultiRadiusJetProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+{
+	Handle<View<reco::Candidate>> candidates;
+	iEvent.getByToken(src_, candidates);
+
+	// Convert the input particles:
+	vector<PseudoJet> particles;
+	particles.reserve(candidates->size());
+	for (unsigned i=0; i < candidates->size(); i++) {
+		const reco::Candidate& candidate = (*candidates)[i];
+		particles.push_back(PseudoJet(candidate.px(), candidate.py(), candidate.pz(), candidate.energy()));
+		particles.back().set_user_index(i);
+	}
+
+	// Cluster once at the largest radius:
+	ClusterSequence cs(particles, JetDefinition(cambridge_algorithm, r_max));
+
+	// Read each radius off of the clustering history:
+	for (unsigned ir=0; ir < radii_.size(); ir++) {
+		/// Every merge has dij = dR^2/r_max^2 and beam distances are 1, so stopping at dcut = (R/r_max)^2 < 1 leaves the R jets.
+		double dcut = pow(radii_[ir]/r_max, 2);
+		vector<PseudoJet> jets_fj;
+		if (radii_[ir] < r_max) jets_fj = sorted_by_pt(cs.exclusive_jets(dcut));
+		else jets_fj = sorted_by_pt(cs.inclusive_jets());
+
+		auto jets_out = make_unique<PFJetCollection>();
+		for (unsigned ijet=0; ijet < jets_fj.size(); ijet++) {
+			const PseudoJet& jet_fj = jets_fj[ijet];
+			if (jet_fj.pt() < jetPtMin_) break;
+
+			vector<CandidatePtr> constituents;
+			vector<PseudoJet> constituents_fj = jet_fj.constituents();
+			for (unsigned ic=0; ic < constituents_fj.size(); ic++) {
+				constituents.push_back(candidates->ptrAt(constituents_fj[ic].user_index()));
+			}
+			PFJet::Specific specific;
+			makeSpecific(constituents, &specific);
+			Particle::LorentzVector p4(jet_fj.px(), jet_fj.py(), jet_fj.pz(), jet_fj.E());
+			jets_out->push_back(PFJet(p4, Particle::Point(0, 0, 0), specific, constituents));
+			jets_out->back().setJetArea(0);		// Areas aren't computed here.
+		}
+		iEvent.put(move(jets_out), labels[ir]);
+	}
+}
+
+
+
+// ------------ method called once each stream before processing any runs, lumis or events  ------------
+void
+MultiRadiusJetProducer::beginStream(edm::StreamID)
+{
+}
+
+// ------------ method called once each stream after processing all runs, lumis and events  ------------
+void
+MultiRadiusJetProducer::endStream() {
+}
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+MultiRadiusJetProducer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  //The following says we do not know what parameters are allowed so do no validation
+  // Please change this to state exactly what you do use, even if it is no parameters
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(MultiRadiusJetProducer);
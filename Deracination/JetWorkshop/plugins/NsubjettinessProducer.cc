@@ -0,0 +1,325 @@
+// system include files
+#include <memory>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+/// CMSSW includes:
+//// Defaults:
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/StreamID.h"
+//// Custom:
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Common/interface/ValueMap.h"
+#include "DataFormats/JetReco/interface/Jet.h"
+#include <fastjet/JetDefinition.hh>
+#include <fastjet/PseudoJet.hh>
+#include <fastjet/ClusterSequence.hh>
+#include "Deracination/JetWorkshop/plugins/ConstituentCache.h"
+
+// NAMESPACES:
+using namespace std;
+using namespace reco;
+using namespace edm;
+using namespace fastjet;
+// \NAMESPACES
+
+//
+// class declaration
+//
+
+// The NsubjettinessProducer computes tau1 ... tauN (and their ratios) for each
+// jet in a collection. The axes for every N come from a single exclusive-kt
+// reclustering of the constituents. With "nPass" = 1 they're refined with the
+// one-pass minimization of fjcontrib's OnePass_KT_Axes (the CMSSW Njettiness
+// default, axesDefinition = 6): each axis moves to the Weiszfeld centre of the
+// constituents nearest to it, repeated until the axes move by less than
+// "accuracy" (summed squared distance per axis) or "maxIterations" is reached.
+// All of the taus are evaluated in one sweep over the constituents. The
+// measure is the normalized one that the CMSSW Njettiness producer uses by
+// default (measureDefinition = 0).
+//
+// If "reference" is set to a CMSSW Njettiness module run on the same jets, the
+// producer compares its taus to that module's, and prints the differences at
+// the end of each stream.
+class NsubjettinessProducer : public edm::stream::EDProducer<> {
+   public:
+      explicit NsubjettinessProducer(const edm::ParameterSet&);
+      ~NsubjettinessProducer();
+
+      static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+   private:
+      virtual void beginStream(edm::StreamID) override;
+      virtual vector<PseudoJet> get_constituents(const reco::Jet&, unsigned);
+      virtual vector<double> get_taus(const vector<PseudoJet>&);
+      virtual void produce(edm::Event&, const edm::EventSetup&) override;
+      virtual void endStream() override;
+      virtual void compare(const Handle<View<reco::Jet>>&, unsigned, const vector<double>&);
+
+      // Member data:
+      /// Arguments:
+      unsigned nMax_;             // Compute tau1 up to tau{nMax}
+      double beta_;               // Angular exponent of the measure
+      double R0_;                 // Characteristic jet radius (normalization)
+      unsigned nPass_;            // 1: one-pass minimization of the exclusive-kt axes, 0: plain exclusive-kt axes
+      unsigned maxIterations_;    // Iteration limit of the one-pass minimization
+      double accuracy_;           // Convergence criterion of the one-pass minimization
+      EDGetTokenT<View<reco::Jet>> src_;
+      unique_ptr<ConstituentCache> cache_;
+      vector<EDGetTokenT<ValueMap<float>>> reference_;   // Taus of a CMSSW Njettiness module to compare to
+      /// Variables:
+      vector<pair<unsigned, unsigned>> ratios;   // (numerator, denominator) of each tau ratio
+      vector<Handle<ValueMap<float>>> reference_taus;
+      vector<double> n_compared, sum_reldiff, max_reldiff, n_reldiff;   // Comparison with "reference" for each N
+};
+
+//
+// constructors and destructor
+//
+NsubjettinessProducer::NsubjettinessProducer(const edm::ParameterSet& iConfig) :
+	nMax_(iConfig.getParameter<unsigned>("nMax")),
+	beta_(iConfig.getParameter<double>("beta")),
+	R0_(iConfig.getParameter<double>("R0")),
+	nPass_(iConfig.getParameter<unsigned>("nPass")),
+	maxIterations_(iConfig.getParameter<unsigned>("maxIterations")),
+	accuracy_(iConfig.getParameter<double>("accuracy")),
+	// Consumes statements:
+	src_(consumes<View<reco::Jet>>(iConfig.getParameter<InputTag>("src")))
+{
+	InputTag constituents = iConfig.getParameter<InputTag>("constituents");
+	if (constituents.label() != "") cache_ = make_unique<ConstituentCache>(constituents, consumesCollector());
+	InputTag reference = iConfig.getParameter<InputTag>("reference");
+	if (reference.label() != "") {
+		for (unsigned n=1; n <= nMax_; n++) reference_.push_back(consumes<ValueMap<float>>(InputTag(reference.label(), "tau" + to_string(n))));
+	}
+	n_compared.assign(nMax_, 0);
+	sum_reldiff.assign(nMax_, 0);
+	max_reldiff.assign(nMax_, 0);
+	n_reldiff.assign(nMax_, 0);
+
+	for (unsigned n=1; n <= nMax_; n++) {
+		produces<ValueMap<float>>("tau" + to_string(n));
+		for (unsigned d=1; d < n; d++) {
+			ratios.push_back(pair<unsigned, unsigned>(n, d));
+			produces<ValueMap<float>>("tau" + to_string(n) + to_string(d));
+		}
+	}
+}
+
+
+NsubjettinessProducer::~NsubjettinessProducer()
+{
+}
+
+
+//
+// member functions
+//
+
+vector<PseudoJet> NsubjettinessProducer::get_constituents(const reco::Jet& jet, unsigned ijet){
+	// Use the shared constituent cache if there is one:
+	if (cache_) return cache_->get_pseudojets(ijet);
+
+	// Otherwise, recover and convert the constituent collection:
+	vector<PseudoJet> constituents;
+	Jet::Constituents daughters = jet.getJetConstituents();
+	for (Jet::Constituents::const_iterator daughter = daughters.begin(); daughter != daughters.end(); daughter++) {
+		constituents.push_back(PseudoJet((*daughter)->px(), (*daughter)->py(), (*daughter)->pz(), (*daughter)->energy()));
+	}
+	return constituents;
+}
+
+vector<double> NsubjettinessProducer::get_taus(const vector<PseudoJet>& constituents){
+	// Returns {tau1, ..., tau{nMax}}.
+	vector<double> taus(nMax_, 0);
+	unsigned nc = constituents.size();
+	if (nc == 0) return taus;
+
+	// Cache the constituent kinematics:
+	vector<double> pt(nc), rap(nc), phi(nc);
+	double norm = 0;
+	for (unsigned k=0; k < nc; k++) {
+		pt[k] = constituents[k].pt();
+		rap[k] = constituents[k].rap();
+		phi[k] = constituents[k].phi();
+		norm += pt[k];
+	}
+	norm *= pow(R0_, beta_);
+	if (norm <= 0) return taus;
+
+	// Find the axes for every N from one exclusive-kt reclustering:
+	/// The axes for N are stored at [first[N - 1], first[N - 1] + N) in "axis_rap" and "axis_phi".
+	ClusterSequence cs(constituents, JetDefinition(kt_algorithm, JetDefinition::max_allowable_R));
+	vector<unsigned> first(nMax_, 0), naxes(nMax_, 0);
+	vector<double> axis_rap, axis_phi;
+	for (unsigned n=1; n <= nMax_; n++) {
+		vector<PseudoJet> axes = cs.exclusive_jets_up_to(n);
+		first[n - 1] = axis_rap.size();
+		naxes[n - 1] = axes.size();
+		for (unsigned j=0; j < axes.size(); j++) {
+			axis_rap.push_back(axes[j].rap());
+			axis_phi.push_back(axes[j].phi());
+		}
+	}
+	unsigned na = axis_rap.size();
+
+	// Nearest-axis distance for every N, for one constituent:
+	auto nearest = [&](unsigned k, unsigned n, double& dr2_min) {
+		unsigned j_min = first[n];
+		dr2_min = -1;
+		for (unsigned j=first[n]; j < first[n] + naxes[n]; j++) {
+			double drap = rap[k] - axis_rap[j];
+			double dphi = fabs(phi[k] - axis_phi[j]);
+			if (dphi > M_PI) dphi = 2*M_PI - dphi;
+			double dr2 = drap*drap + dphi*dphi;
+			if (dr2_min < 0 || dr2 < dr2_min) {
+				dr2_min = dr2;
+				j_min = j;
+			}
+		}
+		return j_min;
+	};
+
+	// One-pass minimization (all N at once, each until its axes converge): move each axis to the weighted centre of the constituents nearest to it.
+	vector<bool> converged(nMax_, nPass_ == 0);
+	for (unsigned n=0; n < nMax_; n++) if (naxes[n] == 0) converged[n] = true;
+	for (unsigned iteration=0; iteration < maxIterations_ && find(converged.begin(), converged.end(), false) != converged.end(); iteration++) {
+		vector<double> sum_w(na, 0), sum_drap(na, 0), sum_dphi(na, 0);
+		for (unsigned k=0; k < nc; k++) {
+			for (unsigned n=0; n < nMax_; n++) {
+				if (converged[n]) continue;
+				double dr2;
+				unsigned j = nearest(k, n, dr2);
+				if (dr2 <= 0) continue;
+				double w = pt[k]*pow(dr2, beta_/2 - 1);     // Weiszfeld weight (just pT for beta = 2)
+				double dphi = phi[k] - axis_phi[j];
+				if (dphi > M_PI) dphi -= 2*M_PI;
+				if (dphi < -M_PI) dphi += 2*M_PI;
+				sum_w[j] += w;
+				sum_drap[j] += w*(rap[k] - axis_rap[j]);
+				sum_dphi[j] += w*dphi;
+			}
+		}
+		for (unsigned n=0; n < nMax_; n++) {
+			if (converged[n]) continue;
+			double moved = 0;      // Summed squared distance that the axes moved (like fjcontrib's AxesRefiner)
+			for (unsigned j=first[n]; j < first[n] + naxes[n]; j++) {
+				if (sum_w[j] <= 0) continue;
+				double drap = sum_drap[j]/sum_w[j], dphi = sum_dphi[j]/sum_w[j];
+				axis_rap[j] += drap;
+				axis_phi[j] += dphi;
+				moved += drap*drap + dphi*dphi;
+			}
+			if (moved/naxes[n] < accuracy_) converged[n] = true;
+		}
+	}
+
+	// Evaluate every tau in one sweep over the constituents:
+	for (unsigned k=0; k < nc; k++) {
+		for (unsigned n=0; n < nMax_; n++) {
+			if (naxes[n] == 0) continue;
+			double dr2;
+			nearest(k, n, dr2);
+			taus[n] += pt[k]*(beta_ == 2 ? dr2 : pow(dr2, beta_/2));
+		}
+	}
+	for (unsigned n=0; n < nMax_; n++) taus[n] /= norm;
+	return taus;
+}
+
+void NsubjettinessProducer::compare(const Handle<View<reco::Jet>>& jets, unsigned ijet, const vector<double>& taus){
+	// Accumulate the relative differences from the reference taus:
+	RefToBase<reco::Jet> ref = jets->refAt(ijet);
+	for (unsigned n=0; n < nMax_; n++) {
+		double tau_ref = (*reference_taus[n])[ref];
+		if (tau_ref <= 0) continue;
+		double reldiff = fabs(taus[n] - tau_ref)/tau_ref;
+		n_compared[n]++;
+		sum_reldiff[n] += reldiff;
+		max_reldiff[n] = max(max_reldiff[n], reldiff);
+		if (reldiff > 1e-3) n_reldiff[n]++;
+	}
+}
+
+// ------------ method called to produce the data  ------------
+void
+NsubjettinessProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+{
+	Handle<View<reco::Jet>> jets;
+	iEvent.getByToken(src_, jets);
+	unsigned nJets = jets->size();
+	if (cache_) cache_->load(iEvent);
+	if (!reference_.empty()) {
+		reference_taus.clear();
+		for (auto& token : reference_) {
+			Handle<ValueMap<float>> h;
+			iEvent.getByToken(token, h);
+			reference_taus.push_back(h);
+		}
+	}
+
+	vector<vector<float>> tau_values(nMax_, vector<float>(nJets, 0));
+	vector<vector<float>> ratio_values(ratios.size(), vector<float>(nJets, 100));		// JetTuplizer has always used 100 for undefined ratios.
+	for (unsigned ijet=0; ijet < nJets; ijet++) {
+		vector<double> taus = get_taus(get_constituents((*jets)[ijet], ijet));
+		for (unsigned n=0; n < nMax_; n++) tau_values[n][ijet] = taus[n];
+		if (!reference_.empty()) compare(jets, ijet, taus);
+		for (unsigned r=0; r < ratios.size(); r++) {
+			double denominator = taus[ratios[r].second - 1];
+			if (denominator > 0) ratio_values[r][ijet] = taus[ratios[r].first - 1]/denominator;
+		}
+	}
+
+	for (unsigned n=0; n < nMax_; n++) {
+		auto variable_out = make_unique<ValueMap<float>>();
+		ValueMap<float>::Filler variable_filler(*variable_out);
+		variable_filler.insert(jets, tau_values[n].begin(), tau_values[n].end());
+		variable_filler.fill();
+		iEvent.put(move(variable_out), "tau" + to_string(n + 1));
+	}
+	for (unsigned r=0; r < ratios.size(); r++) {
+		auto variable_out = make_unique<ValueMap<float>>();
+		ValueMap<float>::Filler variable_filler(*variable_out);
+		variable_filler.insert(jets, ratio_values[r].begin(), ratio_values[r].end());
+		variable_filler.fill();
+		iEvent.put(move(variable_out), "tau" + to_string(ratios[r].first) + to_string(ratios[r].second));
+	}
+}
+
+
+
+// ------------ method called once each stream before processing any runs, lumis or events  ------------
+void
+NsubjettinessProducer::beginStream(edm::StreamID)
+{
+}
+
+// ------------ method called once each stream after processing all runs, lumis and events  ------------
+void
+NsubjettinessProducer::endStream() {
+	if (reference_.empty()) return;
+	cout << "NsubjettinessProducer: comparison with the reference Njettiness taus:" << endl;
+	for (unsigned n=0; n < nMax_; n++) {
+		if (n_compared[n] == 0) continue;
+		cout << "\ttau" << n + 1 << ": " << n_compared[n] << " jets, mean |relative difference| = " << sum_reldiff[n]/n_compared[n];
+		cout << ", max = " << max_reldiff[n] << ", fraction above 1e-3 = " << n_reldiff[n]/n_compared[n] << endl;
+	}
+}
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+NsubjettinessProducer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  //The following says we do not know what parameters are allowed so do no validation
+  // Please change this to state exactly what you do use, even if it is no parameters
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(NsubjettinessProducer);
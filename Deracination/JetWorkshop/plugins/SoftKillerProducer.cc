@@ -0,0 +1,151 @@
+// system include files
+#include <memory>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+/// CMSSW includes:
+//// Defaults:
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/StreamID.h"
+//// Custom:
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Common/interface/Ptr.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+
+// NAMESPACES:
+using namespace std;
+using namespace reco;
+using namespace edm;
+// \NAMESPACES
+
+//
+// class declaration
+//
+
+// The SoftKillerProducer applies SoftKiller pileup mitigation (arXiv:1407.0408)
+// to a particle collection. The event is split into a grid of (rapidity, phi)
+// cells of size "gridSize" up to |y| < "rapidityMax", the hardest particle pT in
+// each cell is found, and every particle softer than the median of those is
+// removed. The output is a list of Ptrs to the particles that survive (like the
+// output of a CandPtrSelector), so it can replace the CHS collection anywhere.
+class SoftKillerProducer : public edm::stream::EDProducer<> {
+   public:
+      explicit SoftKillerProducer(const edm::ParameterSet&);
+      ~SoftKillerProducer();
+
+      static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+   private:
+      virtual void beginStream(edm::StreamID) override;
+      virtual void produce(edm::Event&, const edm::EventSetup&) override;
+      virtual void endStream() override;
+
+      // Member data:
+      /// Arguments:
+      double gridSize_;           // Cell size in rapidity and in phi
+      double rapidityMax_;        // The grid covers |y| < rapidityMax
+      EDGetTokenT<View<reco::Candidate>> src_;
+      /// Variables:
+      unsigned n_y, n_phi;
+      double dy, dphi;
+      vector<double> cell_pt_max;       // Reused each event
+};
+
+//
+// constructors and destructor
+//
+SoftKillerProducer::SoftKillerProducer(const edm::ParameterSet& iConfig) :
+	gridSize_(iConfig.getParameter<double>("gridSize")),
+	rapidityMax_(iConfig.getParameter<double>("rapidityMax")),
+	// Consumes statements:
+	src_(consumes<View<reco::Candidate>>(iConfig.getParameter<InputTag>("src")))
+{
+	// Make the cells as close to "gridSize" as possible while tiling the grid exactly:
+	n_y = max(1, int(2*rapidityMax_/gridSize_ + 0.5));
+	n_phi = max(1, int(2*M_PI/gridSize_ + 0.5));
+	dy = 2*rapidityMax_/n_y;
+	dphi = 2*M_PI/n_phi;
+	cell_pt_max.resize(n_y*n_phi);
+
+	produces<vector<CandidatePtr>>();
+	produces<double>("ptCut");		// The per-event pT threshold, for monitoring.
+}
+
+
+SoftKillerProducer::~SoftKillerProducer()
+{
+}
+
+
+//
+// member functions
+//
+
+// ------------ method called to produce the data  ------------
+void
+SoftKillerProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+{
+	Handle<View<reco::Candidate>> particles;
+	iEvent.getByToken(src_, particles);
+
+	// Find the hardest particle in each cell:
+	fill(cell_pt_max.begin(), cell_pt_max.end(), 0);
+	for (View<reco::Candidate>::const_iterator particle = particles->begin(); particle != particles->end(); particle++) {
+		double y = particle->rapidity();
+		if (fabs(y) >= rapidityMax_) continue;
+		double phi = particle->phi();
+		if (phi < 0) phi += 2*M_PI;
+		unsigned iy = min(n_y - 1, unsigned((y + rapidityMax_)/dy));
+		unsigned iphi = min(n_phi - 1, unsigned(phi/dphi));
+		double& pt_max = cell_pt_max[iy*n_phi + iphi];
+		pt_max = max(pt_max, particle->pt());
+	}
+
+	// The pT cut is the median of the cell maxima (empty cells count as 0):
+	vector<double> pts(cell_pt_max);
+	unsigned half = pts.size()/2;
+	nth_element(pts.begin(), pts.begin() + half, pts.end());
+	double pt_cut = pts[half];
+	if (pts.size() % 2 == 0) pt_cut = (pt_cut + *max_element(pts.begin(), pts.begin() + half))/2;
+
+	// Keep the particles that are at least that hard:
+	auto particles_out = make_unique<vector<CandidatePtr>>();
+	particles_out->reserve(particles->size());
+	for (unsigned i=0; i < particles->size(); i++) {
+		if ((*particles)[i].pt() >= pt_cut) particles_out->push_back(particles->ptrAt(i));
+	}
+
+	iEvent.put(move(particles_out));
+	iEvent.put(make_unique<double>(pt_cut), "ptCut");
+}
+
+
+
+// ------------ method called once each stream before processing any runs, lumis or events  ------------
+void
+SoftKillerProducer::beginStream(edm::StreamID)
+{
+}
+
+// ------------ method called once each stream after processing all runs, lumis and events  ------------
+void
+SoftKillerProducer::endStream() {
+}
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+SoftKillerProducer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  //The following says we do not know what parameters are allowed so do no validation
+  // Please change this to state exactly what you do use, even if it is no parameters
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(SoftKillerProducer);
@@ -19,6 +19,7 @@
 #include "fastjet/tools/Filter.hh"
 #include <fastjet/ClusterSequence.hh>
 #include <fastjet/ClusterSequenceArea.hh>
+#include "Deracination/JetWorkshop/plugins/ConstituentCache.h"
 
 // NAMESPACES:
 using namespace std;
@@ -41,7 +42,8 @@ class SubjetProducer : public edm::stream::EDProducer<> {
    private:
       virtual void beginStream(edm::StreamID) override;
 //      virtual vector<PseudoJet> get_subjets(pat::Jet, JetDefinition, int);
-      virtual vector<PseudoJet> get_subjets(reco::Jet, JetDefinition, unsigned);
+      virtual vector<PseudoJet> get_constituents(const reco::Jet&, unsigned);
+      virtual vector<PseudoJet> get_subjets(const vector<PseudoJet>&, JetDefinition, unsigned);
       virtual void produce(edm::Event&, const edm::EventSetup&) override;
       virtual void endStream() override;
 
@@ -54,6 +56,7 @@ class SubjetProducer : public edm::stream::EDProducer<> {
       /// Arguments:
       unsigned nSubjets_;
       EDGetTokenT<View<reco::Jet>> src_;
+      unique_ptr<ConstituentCache> cache_;		// Constituents from a ConstituentProducer (null: use the jet's own Ptrs)
       /// Variables:
       vector<string> subjet_variables;
 };
@@ -76,6 +79,8 @@ SubjetProducer::SubjetProducer(const edm::ParameterSet& iConfig) :
 //	ca12Collection_(consumes<View<pat::Jet>>(iConfig.getParameter<InputTag>("ca12Collection")))
 	src_(consumes<View<reco::Jet>>(iConfig.getParameter<InputTag>("src")))
 {
+	InputTag constituents = iConfig.getParameter<InputTag>("constituents");
+	if (constituents.label() != "") cache_ = make_unique<ConstituentCache>(constituents, consumesCollector());
 	subjet_variables = {"px", "py", "pz", "e", "pt", "m", "eta", "phi"};
 	for (vector<string>::const_iterator v = subjet_variables.begin(); v != subjet_variables.end(); v++) {
 		for (unsigned isj=0; isj < nSubjets_; isj++) {
@@ -100,14 +105,20 @@ SubjetProducer::~SubjetProducer()
 //
 
 
-vector<PseudoJet> SubjetProducer::get_subjets(reco::Jet jet, JetDefinition algo, unsigned n=4){
-	// Recover and convert constituent collection:
+vector<PseudoJet> SubjetProducer::get_constituents(const reco::Jet& jet, unsigned ijet){
+	// Use the shared constituent cache if there is one:
+	if (cache_) return cache_->get_pseudojets(ijet);
+	
+	// Otherwise, recover and convert the constituent collection:
 	vector<PseudoJet> constituents;
 	Jet::Constituents daughters = jet.getJetConstituents();		// PFJet
 	for (Jet::Constituents::const_iterator daughter = daughters.begin(); daughter != daughters.end(); daughter++) {
 		constituents.push_back(PseudoJet((*daughter)->px(), (*daughter)->py(), (*daughter)->pz(), (*daughter)->energy()));
 	}
-	
+	return constituents;
+}
+
+vector<PseudoJet> SubjetProducer::get_subjets(const vector<PseudoJet>& constituents, JetDefinition algo, unsigned n=4){
 	// Recluster the jet:
 	ClusterSequence cs(constituents, algo);
 	
@@ -128,6 +139,7 @@ SubjetProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
 	Handle<View<reco::Jet>> jets;
 	iEvent.getByToken(src_, jets);
 	unsigned nJets = jets->size();
+	if (cache_) cache_->load(iEvent);
 	vector<float> values(nJets, 0);
 	
 //	vector<vector<float>> subjet_px(nSubjets_), subjet_py(nSubjets_)cd;
@@ -148,9 +160,9 @@ SubjetProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
 	for (unsigned ijet=0; ijet < jets->size(); ijet++) {		// Only find subjets for two leading jets.
 		if (ijet > 1) break;
 //		pat::Jet jet = (*jets)[ijet];
-		reco::Jet jet = (*jets)[ijet];
+		const reco::Jet& jet = (*jets)[ijet];
 //		cout << "jet:" << ijet << endl;
-		vector<PseudoJet> subjets = get_subjets(jet, algo_kt15, nSubjets_);
+		vector<PseudoJet> subjets = get_subjets(get_constituents(jet, ijet), algo_kt15, nSubjets_);
 //		cout << subjets.size() << endl;
 		for (unsigned isj=0; isj < nSubjets_; isj++) {
 			subjet_values["px" + to_string(isj)][ijet] = subjets[isj].px();
@@ -1,6 +1,6 @@
 
 # IMPORTS:
-import re
+import re, sys
 
 import FWCore.ParameterSet.Config as cms
 
@@ -19,7 +19,8 @@ from PhysicsTools.PatAlgos.producersLayer1.patCandidates_cff import *
 from PhysicsTools.PatAlgos.selectionLayer1.jetSelector_cfi import selectedPatJets
 from PhysicsTools.PatAlgos.tools.jetTools import addJetCollection, updateJetCollection
 from RecoJets.JetProducers.nJettinessAdder_cfi import Njettiness
-from Deracination.JetWorkshop.subjetAdder_cfi import Subjetter, subjet_variables
+from Deracination.JetWorkshop.nsubjettinessAdder_cfi import Nsubjettiness, tau_ratios
+from Deracination.JetWorkshop.subjetAdder_cfi import Subjetter, Constituenter, subjet_variables
 # /IMPORTS
 
 # CLASSES:
@@ -140,6 +141,22 @@ input_tags_aod = {		# Labels from AOD for the input objects. (I don't use these.
 	"lm": "muons",
 }
 input_tags = input_tags_maod
+area_modes = {		# Jet area definitions for the FastjetJetProducer. (The area is only used for L1FastJet corrections.)
+	"none": {               # No area (no ghosts are clustered)
+		"doAreaFastjet": cms.bool(False),
+	},
+	"active": {             # Active area with the standard ghost grid (ghostArea = 0.01)
+		"doAreaFastjet": cms.bool(True),
+	},
+	"coarse": {             # Active area with a 5x sparser ghost grid
+		"doAreaFastjet": cms.bool(True),
+		"ghostArea": cms.double(0.05),
+	},
+	"voronoi": {            # Voronoi area (no ghosts)
+		"doAreaFastjet": cms.bool(True),
+		"voronoiRfact": cms.double(0.9),
+	},
+}
 # /VARIABLES
 
 # FUNCTIONS:
@@ -170,17 +187,42 @@ def apply_chs(process, sequence, tags_dict):
 	return tag
 
 
-def make_pfjet_collection(process, sequence, pfcon_tag, algo, pum, groom=None):
+def apply_sk(process, sequence, tags_dict, grid_size=0.4, rapidity_max=4.0):
+	# Apply SoftKiller to the PF particle collection: remove particles softer than the median of the hardest pT in each grid cell.
+	tag = "{}SK".format(tags_dict["pf"])
+	setattr(process, tag,
+		cms.EDProducer("SoftKillerProducer",
+			src=cms.InputTag(tags_dict["pf"]),
+			gridSize=cms.double(grid_size),
+			rapidityMax=cms.double(rapidity_max),
+		)
+	)
+	sequence += getattr(process, tag)
+	tags_dict["pf"] = tag
+	return tag
+
+
+def get_area_arguments(area):
+	# Jet producer arguments for an area mode (see "area_modes"):
+	if area not in area_modes:
+		print "ERROR: I don't know about the jet area mode you called {}.".format(area)
+		sys.exit()
+	return dict(area_modes[area])
+
+
+def make_pfjet_collection(process, sequence, pfcon_tag, algo, pum, groom=None, area=None):
 	# Make a PF jet collection:
 	tag_jets = "jetsPF" + algo.name.upper() + pum.title
 	if groom:
 		tag_jets += groom.title
+	if area == None:
+		area = "none" if groom else "active"		# Groomed collections don't need areas.
 	
 	# Jet producer arguments:
 	arguments = {
 		"src": cms.InputTag(pfcon_tag),
-		"doAreaFastjet": True,
 	}
+	arguments.update(get_area_arguments(area))
 ##	## Subjet arguments:
 #	arguments.update({
 #		"writeCompound": cms.bool(True),
@@ -189,9 +231,10 @@ def make_pfjet_collection(process, sequence, pfcon_tag, algo, pum, groom=None):
 #	})
 	
 	if groom:
-		arguments.update({
-			"useExplicitGhosts": cms.bool(True),		# The code (https://github.com/cms-sw/cmssw/blob/CMSSW_8_1_X/RecoJets/JetProducers/plugins/FastjetJetProducer.cc#L152) makes it look like I don't need this, but warnings say otherwise.
-		})
+		if area in ["active", "coarse"]:
+			arguments.update({
+				"useExplicitGhosts": cms.bool(True),		# The code (https://github.com/cms-sw/cmssw/blob/CMSSW_8_1_X/RecoJets/JetProducers/plugins/FastjetJetProducer.cc#L152) makes it look like I don't need this, but warnings say otherwise.
+			})
 		for key, value in groom.params.items():
 			arguments[key] = value
 		if groom.name in ["s"]:
@@ -220,9 +263,21 @@ def make_pfjet_collection(process, sequence, pfcon_tag, algo, pum, groom=None):
 	return tag_jets
 
 
-def groom_pfjet_collection(process, sequence, pfjet_tag, patjet_tag, algo, groom):
+def make_constituent_cache(process, sequence, pfjet_tag):
+	# Convert the constituents of each jet into flat vectors once, so that the modules that need them don't each chase the constituent Ptrs.
+	tag = pfjet_tag.replace("jets", "cache")
+	cache_producer = Constituenter.clone(
+		src=cms.InputTag(pfjet_tag),
+	)
+	setattr(process, tag, cache_producer)
+	sequence += getattr(process, tag)
+	return tag
+
+
+def groom_pfjet_collection(process, sequence, pfjet_tag, patjet_tag, algo, groom, area="none"):
 	# Make a groomed basicjet collection with the same ordering as the ungroomed pfjet collection.
 	# NOTES: You can only run this after you run "make_pfjet_collection"
+	# (Only the groomed mass is used from this, so it doesn't need an area by default.)
 	
 	tag_jets = pfjet_tag.replace("jets", "jetsBasic") + groom.title
 	tag_mass = pfjet_tag.replace("jetsPF", "mass") + groom.title
@@ -232,10 +287,10 @@ def groom_pfjet_collection(process, sequence, pfjet_tag, patjet_tag, algo, groom
 	arguments_jet = {
 		"src": cms.InputTag(tag_cons + ':constituents'),
 		"writeCompound": cms.bool(True),
-		"doAreaFastjet": cms.bool(True),
 		"jetCollInstanceName": cms.string('constituents'),
-		"useExplicitGhosts": cms.bool(True),
 	}
+	arguments_jet.update(get_area_arguments(area))
+	if area in ["active", "coarse"]: arguments_jet["useExplicitGhosts"] = cms.bool(True)
 	for key, value in groom.params.items(): arguments_jet[key] = value
 	if groom.name in ["s"]: arguments_jet["R0"] = cms.double(algo.r)
 	
@@ -325,36 +380,68 @@ def make_patjet_collection(process, sequence, pfjet_tag, gnjet_tag, tags_dict, a
 	getattr(process, tag).addTagInfos = cms.bool(True)
 	return tag
 
-def add_tau_variables(process, sequence, pfjet_tag, patjet_tag, algo, taus):
+def add_tau_variables(process, sequence, pfjet_tag, patjet_tag, algo, taus, cache_tag="", producer="njettiness"):
+	# "producer" is "njettiness" (the CMSSW Njettiness module), "nsubjettiness" (the JetWorkshop NsubjettinessProducer),
+	# or "compare" (Njettiness makes the userFloats, and the NsubjettinessProducer runs next to it and prints how different its taus are).
 #	tag = "taus" + patjet_tag.replace("patJets", "")
 	tag = "taus" + pfjet_tag.replace("jetsPF", "")
-	tau_calculator = Njettiness.clone(
-		src=cms.InputTag(pfjet_tag),
-		Njets=cms.vuint32(taus),
-		# variables for measure definition: 
-		measureDefinition = cms.uint32(0),    # CMS default is normalized measure
-		beta=cms.double(1.0),                 # CMS default is 1
-		R0=cms.double(algo.r),                # CMS default is jet cone size
-		Rcutoff=cms.double(999.0),            # not used by default
-		# variables for axes definition:
-		axesDefinition=cms.uint32(6),         # CMS default is 1-pass KT axes
-		nPass=cms.int32(999),                 # not used by default
-		akAxesR0=cms.double(-999.0),          # not used by default
-	)
+	n_max = max(taus)
+	if producer == "nsubjettiness":
+		tau_calculator = Nsubjettiness.clone(
+			src=cms.InputTag(pfjet_tag),
+			constituents=cms.InputTag(cache_tag),
+			nMax=cms.uint32(n_max),               # All of the taus (and their axes) come from one reclustering.
+			beta=cms.double(1.0),                 # CMS default is 1
+			R0=cms.double(algo.r),                # CMS default is jet cone size
+			nPass=cms.uint32(1),                  # CMS default is 1-pass KT axes
+		)
+	else:
+		tau_calculator = Njettiness.clone(
+			src=cms.InputTag(pfjet_tag),
+			Njets=cms.vuint32(taus),
+			# variables for measure definition: 
+			measureDefinition = cms.uint32(0),    # CMS default is normalized measure
+			beta=cms.double(1.0),                 # CMS default is 1
+			R0=cms.double(algo.r),                # CMS default is jet cone size
+			Rcutoff=cms.double(999.0),            # not used by default
+			# variables for axes definition:
+			axesDefinition=cms.uint32(6),         # CMS default is 1-pass KT axes
+			nPass=cms.int32(999),                 # not used by default
+			akAxesR0=cms.double(-999.0),          # not used by default
+		)
 	setattr(process, tag, tau_calculator)
 	
 	for tau in taus:
 		getattr(process, patjet_tag).userData.userFloats.src += ['{}:tau{}'.format(tag, tau)]
+	if producer == "nsubjettiness":
+		for ratio in tau_ratios(n_max):
+			getattr(process, patjet_tag).userData.userFloats.src += ['{}:{}'.format(tag, ratio)]
 	
 	sequence += getattr(process, tag)
+	
+	if producer == "compare":
+		tag_check = tag + "Check"
+		setattr(process, tag_check, Nsubjettiness.clone(
+			src=cms.InputTag(pfjet_tag),
+			constituents=cms.InputTag(cache_tag),
+			nMax=cms.uint32(n_max),
+			beta=cms.double(1.0),
+			R0=cms.double(algo.r),
+			nPass=cms.uint32(1),
+			reference=cms.InputTag(tag),
+		))
+		## Nothing consumes the check, so it isn't run unscheduled. It's collected in "process.tauChecks", which the job has to put on a path:
+		if hasattr(process, "tauChecks"): process.tauChecks += getattr(process, tag_check)
+		else: process.tauChecks = cms.Sequence(getattr(process, tag_check))
 	return tag
 
 
-def add_subjet_variables(process, sequence, pfjet_tag, patjet_tag, algo, nsubjets):
+def add_subjet_variables(process, sequence, pfjet_tag, patjet_tag, algo, nsubjets, cache_tag=""):
 	tag = "subjets" + patjet_tag.replace("patJets", "")
 	subjet_calculator = Subjetter.clone(
 		src=cms.InputTag(pfjet_tag),
 		nSubjets=cms.uint32(nsubjets),
+		constituents=cms.InputTag(cache_tag),
 	)
 	setattr(process, tag, subjet_calculator)
 	
@@ -366,6 +453,53 @@ def add_subjet_variables(process, sequence, pfjet_tag, patjet_tag, algo, nsubjet
 	return tag
 
 
+def radius_label(r):
+	# The instance label the MultiRadiusJetProducer uses for a radius (0.8 -> "R08"):
+	return "R{:02d}".format(int(r*10 + 0.5))
+
+
+def make_pfjet_radius_scan(process, sequence, pfcon_tag, radii, pum, pt_min=5.0):
+	# Make CA PF jet collections for several radii from a single clustering at the largest radius.
+	# Each collection is "tag:R08", "tag:R12", etc. (see "radius_label").
+	tag = "jetsPFCAScan" + pum.title
+	jet_producer = cms.EDProducer("MultiRadiusJetProducer",
+		src=cms.InputTag(pfcon_tag),
+		radii=cms.vdouble(radii),
+		jetPtMin=cms.double(pt_min),
+	)
+	setattr(process, tag, jet_producer)
+	sequence += getattr(process, tag)
+	return {r: cms.InputTag(tag, radius_label(r)) for r in radii}
+
+
+def add_conesize_collections(
+	process,
+	radii=[0.8, 1.0, 1.2, 1.5],     # The CA cone sizes to make.
+	pum_name="chs",                 # Pileup mitigation name.
+	data=False,                     # Is the input dataset data? (False: MC, True: data)
+	tags_dict=input_tags.copy(),
+	output="out",                   # The name of the PoolOutputModule.
+):
+	# Make CA PF jets for a cone-size scan. This costs one clustering however many radii there are.
+	tags_dict = tags_dict.copy()
+	pum = pileup_mitigation(pum_name)
+	sequence = cms.Sequence()
+	
+	# Apply PUM (pileup mitigation):
+	if pum.name == "chs":
+		apply_chs(process, sequence, tags_dict)
+	elif pum.name == "sk":
+		apply_sk(process, sequence, tags_dict)
+	else:
+		print "ERROR: The PUM you called {} is not implemented.".format(pum.name)
+		sys.exit()
+	
+	jet_tags = make_pfjet_radius_scan(process, sequence, tags_dict["pf"], radii, pum)
+	
+	getattr(process, output).outputCommands.extend(["keep *_jetsPFCAScan*_*_*"])
+	return jet_tags
+
+
 def add_jet_collection(
 	process,
 	algo_name="ca12",               # The name of the jet algorithm to use.
@@ -376,6 +510,8 @@ def add_jet_collection(
 	output="out",                   # The name of the PoolOutputModule.
 	taus=None,
 	keep_all=False,
+	area="active",                  # Area mode for the ungroomed collection (see "area_modes"). Groomed collections get no area.
+	tau_producer="njettiness",      # Which module computes the taus (see "add_tau_variables").
 ):
 	# Arguments:
 	tags_dict_original = tags_dict.copy()
@@ -404,19 +540,22 @@ def add_jet_collection(
 	# Apply PUM (pileup mitigation):
 	if pum.name == "chs":
 		apply_chs(process, sequence, tags_dict)
+	elif pum.name == "sk":
+		apply_sk(process, sequence, tags_dict)
 	else:
 		print "ERROR: The PUM you called {} is not implemented.".format(pum.name)
 		sys.exit()
 	
 	# Make normal jet collections:
-	pfjet_tag = make_pfjet_collection(process, sequence, tags_dict["pf"], algo, pum)
+	pfjet_tag = make_pfjet_collection(process, sequence, tags_dict["pf"], algo, pum, area=area)
+	cache_tag = make_constituent_cache(process, sequence, pfjet_tag)
 #	pfsubjet_tag = make_pfsubjet_collection(process, sequence, tags_dict["pf"], algo, pum)
 	gnjet_tag = make_gnjet_collection(process, sequence, tags_dict["gn_pat"], algo, "NoNu", data=data)
 	patjet_tag = make_patjet_collection(process, sequence, pfjet_tag, gnjet_tag, tags_dict, algo, algo.name.upper() + pum.title, matching=not data)
 	## Nsubjettiness for ungroomed collections:
-	if taus: tau_tag = add_tau_variables(process, sequence, pfjet_tag, patjet_tag, algo, taus)
+	if taus: tau_tag = add_tau_variables(process, sequence, pfjet_tag, patjet_tag, algo, taus, cache_tag=cache_tag, producer=tau_producer)
 	
-	if algo.name == "ca12": subjet_tag = add_subjet_variables(process, sequence, pfjet_tag, patjet_tag, algo, 4)
+	if algo.name == "ca12": subjet_tag = add_subjet_variables(process, sequence, pfjet_tag, patjet_tag, algo, 4, cache_tag=cache_tag)
 	
 #	blah = make_groomed_jet_collection(process, sequence, pfjet_tag, algo, jet_groomer("p"))
 #	blah2 = make_patjet_collection(process, sequence, blah, gnjet_tag, tags_dict, algo, algo.name.upper() + pum.title + jet_groomer("p").title, matching=not data)
@@ -431,7 +570,9 @@ def add_jet_collection(
 		pfjet_tags_groomed[groom.name] = make_pfjet_collection(process, sequence, tags_dict["pf"], algo, pum, groom)
 		patjet_tags_groomed[groom.name] = make_patjet_collection(process, sequence, pfjet_tags_groomed[groom.name], gnjet_tag, tags_dict, algo, algo.name.upper() + pum.title + groom.title, matching=False)
 		## Nsubjettiness for groomed collections:
-		if taus: tau_tags_groomed[groom.name] = add_tau_variables(process, sequence, pfjet_tags_groomed[groom.name], patjet_tags_groomed[groom.name], algo, taus)		#patjet_tags_groomed[groom.name]
+		if taus:
+			cache_tag_groomed = make_constituent_cache(process, sequence, pfjet_tags_groomed[groom.name]) if tau_producer != "njettiness" else ""
+			tau_tags_groomed[groom.name] = add_tau_variables(process, sequence, pfjet_tags_groomed[groom.name], patjet_tags_groomed[groom.name], algo, taus, cache_tag=cache_tag_groomed, producer=tau_producer)		#patjet_tags_groomed[groom.name]
 
 	# Define output:
 	products_keep = [
@@ -445,6 +586,7 @@ def add_jet_collection(
 		"*_mass*_*_*",
 		"*_taus*_*_*",
 		"*_subjets*_*_*",
+		"*_*SK_ptCut_*",		# The SoftKiller pT threshold in each event
 #		"*_packedPFCandidatesCHS_*_*",
 	]
 #	if keep_all: products_keep.extend(["*_jets*_*_*", "*_patJets*_*_*"])
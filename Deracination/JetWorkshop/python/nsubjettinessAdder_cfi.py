@@ -0,0 +1,17 @@
+import FWCore.ParameterSet.Config as cms
+
+Nsubjettiness = cms.EDProducer("NsubjettinessProducer",
+	src=cms.InputTag("ca12PFJetsCHS"),
+	constituents=cms.InputTag(""),		# A ConstituentProducer made from "src" (empty: read the jet constituents directly).
+	nMax=cms.uint32(5),                 # Compute tau1, ..., tau{nMax} and every ratio between them
+	beta=cms.double(1.0),               # CMS default is 1
+	R0=cms.double(1.2),                 # CMS default is jet cone size
+	nPass=cms.uint32(1),                # One-pass minimization of the exclusive-kt axes, like Njettiness's axesDefinition 6 (0: plain exclusive-kt axes)
+	maxIterations=cms.uint32(100),      # The minimization stops after this many iterations (fjcontrib's default) ...
+	accuracy=cms.double(0.0001),        # ... or when the axes move by less than this (fjcontrib's default)
+	reference=cms.InputTag(""),         # A CMSSW Njettiness module on the same jets to compare the taus to (empty: no comparison)
+)
+
+def tau_ratios(n_max):
+	# The ratio names the producer makes, like "tau21" and "tau43":
+	return ["tau{}{}".format(n, d) for n in range(1, n_max + 1) for d in range(1, n)]
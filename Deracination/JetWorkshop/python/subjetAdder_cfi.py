@@ -1,8 +1,13 @@
 import FWCore.ParameterSet.Config as cms
 
+Constituenter = cms.EDProducer("ConstituentProducer",
+	src=cms.InputTag("ca12PFJetsCHS"),
+)
+
 subjet_variables = ["px", "py", "pz", "e", "pt", "m", "eta", "phi"]
 
 Subjetter = cms.EDProducer("SubjetProducer",
 	src=cms.InputTag("ca12PFJetsCHS"),
 	nSubjets=cms.uint32(4),
+	constituents=cms.InputTag(""),		# A ConstituentProducer made from "src" (empty: read the jet constituents directly).
 )
@@ -0,0 +1,29 @@
+# Compares the cheaper jet area modes to the active area using the output of "test_jetarea_cfg.py".
+import ROOT
+ROOT.gROOT.SetBatch()
+from DataFormats.FWLite import Events, Handle
+
+events = Events('jetarea.root')
+
+label_active = "jetsPFCA12CHS"
+labels = ["jetsPFCA12CHSCoarse", "jetsPFCA12CHSVoronoi"]
+handle_active = Handle('std::vector<reco::PFJet>')
+handles = {label: Handle('std::vector<reco::PFJet>') for label in labels}
+ratios = {label: [] for label in labels}
+
+for event in events:
+	event.getByLabel(label_active, handle_active)
+	jets_active = handle_active.product()
+	for label in labels:
+		event.getByLabel(label, handles[label])
+		jets = handles[label].product()
+		for jet_active, jet in zip(jets_active, jets):		# Only the area differs, so the jets are in the same order.
+			if jet_active.pt() < 200 or jet_active.jetArea() <= 0: continue
+			ratios[label].append(jet.jetArea()/jet_active.jetArea())
+
+for label in labels:
+	n = len(ratios[label])
+	if not n: continue
+	mean = sum(ratios[label])/n
+	rms = (sum([(r - mean)**2 for r in ratios[label]])/n)**0.5
+	print "{}: A/A_active = {:.4f} +- {:.4f} ({} jets with pT > 200 GeV)".format(label, mean, rms, n)
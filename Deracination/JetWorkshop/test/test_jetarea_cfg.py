@@ -0,0 +1,44 @@
+# Makes ungroomed CA12 jets with each jet area mode so that the cheaper ones can be checked against the active area.
+# Run this, then "python jetarea_analyzer.py".
+import sys
+import FWCore.ParameterSet.Config as cms
+
+process = cms.Process('area')
+
+process.load('FWCore.MessageLogger.MessageLogger_cfi')
+process.MessageLogger.cerr.FwkReport.reportEvery = 100
+
+process.options = cms.untracked.PSet( wantSummary = cms.untracked.bool(True) )		# The timing summary shows the cost of each mode.
+process.options.allowUnscheduled = cms.untracked.bool(True)
+
+process.out = cms.OutputModule('PoolOutputModule',
+	fileName=cms.untracked.string('jetarea.root'),
+	outputCommands=cms.untracked.vstring(
+		'drop *',
+		'keep *_jetsPFCA12CHS*_*_*',
+	),
+)
+
+
+# Make jet collections:
+from Deracination.JetWorkshop.jetWorkshop_cff import jet_algorithm, pileup_mitigation, apply_chs, make_pfjet_collection, get_area_arguments, input_tags
+
+algo = jet_algorithm("ca12")
+pum = pileup_mitigation("chs")
+tags_dict = input_tags.copy()
+process.jetAreaSequence = cms.Sequence()
+apply_chs(process, process.jetAreaSequence, tags_dict)
+tag_jets = make_pfjet_collection(process, process.jetAreaSequence, tags_dict["pf"], algo, pum, area="active")
+for area in ["coarse", "voronoi"]:
+	setattr(process, tag_jets + area.title(), getattr(process, tag_jets).clone(**get_area_arguments(area)))
+	process.jetAreaSequence += getattr(process, tag_jets + area.title())
+
+process.p = cms.Path(process.jetAreaSequence)
+process.endpath = cms.EndPath(process.out)
+
+process.maxEvents = cms.untracked.PSet( input = cms.untracked.int32(1000) )
+process.source = cms.Source("PoolSource",
+		fileNames = cms.untracked.vstring(
+			"file:/cms/tote/store/examples/maod_mc_qcdmg2000_fall15_10000.root",
+			)
+		)
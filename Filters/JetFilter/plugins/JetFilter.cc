@@ -11,21 +11,23 @@
 // system include files
 #include <memory>
 #include <typeinfo>
-#include <algorithm>    // std::min
+#include <algorithm>    // std::min, std::sort
+#include <cmath>
 
 // user include files
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/EDFilter.h"
+#include "FWCore/Framework/interface/global/EDFilter.h"
 #include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/LuminosityBlock.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
 
 /// Custom includes:
 #include "DataFormats/Common/interface/Handle.h"
 #include "DataFormats/PatCandidates/interface/Jet.h"
 #include "FWCore/Common/interface/TriggerNames.h"
 #include "DataFormats/Common/interface/TriggerResults.h"
-#include "DataFormats/PatCandidates/interface/PackedTriggerPrescales.h"
 
 
 // NAMESPACES:
@@ -37,7 +39,48 @@ using namespace edm;
 // class declaration
 //
 
-class JetFilter : public edm::EDFilter {
+// The JetFilter applies a list of selection stages ("stages", a VPSet). Each
+// stage is one of the following (chosen with its "type"):
+//   * "trigger": at least one HLT path starting with one of "paths" fired,
+//   * "jets": the "n" leading jets of "src" have pT > "pt" and |eta| < "eta" (-1 turns the eta cut off),
+//   * "ht": the scalar pT sum of the jets in "src" with pT > "pt" is greater than "ht".
+// The stages are compiled once at construction and sorted cheapest first, and
+// an event is rejected at the first stage that it fails. The number of events
+// that pass each stage (and all of the stages before it) is put into each
+// luminosity block ("counts": n, n_passed, then one count per stage, and
+// "stages": the stage names), where the JetFilterSummary writes it to a
+// "lumis" tree.
+//
+// This is a global module, so one instance serves every stream: the only
+// per-event state (the trigger path indices and the counts for the current
+// luminosity block) lives in a per-stream cache, and the stream counts are
+// summed into a per-lumi summary by the framework. It doesn't touch the
+// TFileService, which isn't thread safe; that's left to the JetFilterSummary,
+// a "one" module that declares it as a shared resource.
+namespace jetfilter {
+	struct Counts {
+		Counts(unsigned n_stages) : nevents(0), nevents_passed(0), nevents_stage(n_stages, 0) {}
+		void clear() {
+			nevents = nevents_passed = 0;
+			fill(nevents_stage.begin(), nevents_stage.end(), 0);
+		}
+		void add(const Counts& other) {
+			nevents += other.nevents;
+			nevents_passed += other.nevents_passed;
+			for (unsigned i=0; i < nevents_stage.size(); i++) nevents_stage[i] += other.nevents_stage[i];
+		}
+		unsigned nevents, nevents_passed;
+		vector<unsigned> nevents_stage;         // Events that passed each stage (and every earlier one)
+	};
+	struct StreamCache {
+		StreamCache(unsigned n_stages) : indices(n_stages), counts(n_stages) {}
+		ParameterSetID trigger_names_id;        // The trigger menu that the "indices" were found for
+		vector<vector<unsigned>> indices;       // Indices of the matching paths of each trigger stage
+		Counts counts;                          // Counts for the current luminosity block
+	};
+}
+
+class JetFilter : public edm::global::EDFilter<edm::StreamCache<jetfilter::StreamCache>, edm::LuminosityBlockSummaryCache<jetfilter::Counts>, edm::EndLuminosityBlockProducer> {
    public:
       explicit JetFilter(const edm::ParameterSet&);
       ~JetFilter();
@@ -45,24 +88,36 @@ class JetFilter : public edm::EDFilter {
       static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
 
    private:
+      enum StageType {TRIGGER, JETS, HT};
+      struct Stage {
+	      string name;
+	      StageType type;
+	      unsigned index;                 // Position in the configured list
+	      /// Trigger stages:
+	      vector<string> paths;           // HLT path prefixes (OR)
+	      /// Jet stages:
+	      EDGetTokenT<vector<pat::Jet>> src;
+	      unsigned n;
+	      double pt, eta, ht;
+      };
+
       virtual void beginJob() override;
-      virtual bool filter(edm::Event&, const edm::EventSetup&) override;
+      virtual bool filter(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
       virtual void endJob() override;
-      
-      //virtual void beginRun(edm::Run const&, edm::EventSetup const&) override;
-      //virtual void endRun(edm::Run const&, edm::EventSetup const&) override;
-      //virtual void beginLuminosityBlock(edm::LuminosityBlock const&, edm::EventSetup const&) override;
-      //virtual void endLuminosityBlock(edm::LuminosityBlock const&, edm::EventSetup const&) override;
+      virtual unique_ptr<jetfilter::StreamCache> beginStream(edm::StreamID) const override;
+      virtual void streamBeginLuminosityBlock(edm::StreamID, edm::LuminosityBlock const&, edm::EventSetup const&) const override;
+      virtual shared_ptr<jetfilter::Counts> globalBeginLuminosityBlockSummary(edm::LuminosityBlock const&, edm::EventSetup const&) const override;
+      virtual void streamEndLuminosityBlockSummary(edm::StreamID, edm::LuminosityBlock const&, edm::EventSetup const&, jetfilter::Counts*) const override;
+      virtual void globalEndLuminosityBlockSummary(edm::LuminosityBlock const&, edm::EventSetup const&, jetfilter::Counts*) const override;
+      virtual void globalEndLuminosityBlockProduce(edm::LuminosityBlock&, edm::EventSetup const&, jetfilter::Counts const*) const override;
+
+      bool pass_trigger(const edm::Event&, unsigned, jetfilter::StreamCache&) const;
+      bool pass_jets(const edm::Event&, const Stage&) const;
+      bool pass_ht(const edm::Event&, const Stage&) const;
 
       // ----------member data ---------------------------
-      double cut_pt_, cut_eta_;
-      bool cut_smu_;
-      int nevents, nevents_passed;
-      
-	// ?
-	EDGetTokenT<vector<pat::Jet>> jetCollection_;
-	EDGetTokenT<TriggerResults> triggerResults_;
-	EDGetTokenT<pat::PackedTriggerPrescales> triggerPrescales_;
+      vector<Stage> stages_;
+      EDGetTokenT<TriggerResults> triggerResults_;
 };
 
 //
@@ -77,26 +132,54 @@ class JetFilter : public edm::EDFilter {
 // constructors and destructor
 //
 JetFilter::JetFilter(const edm::ParameterSet& iConfig):
-	cut_pt_(iConfig.getParameter<double>("cut_pt")),
-	cut_eta_(iConfig.getParameter<double>("cut_eta")),
-	cut_smu_(iConfig.getParameter<bool>("cut_smu")),
-	
-	//?
-	jetCollection_(consumes<vector<pat::Jet>>(iConfig.getParameter<InputTag>("jetCollection"))),
-	triggerResults_(consumes<TriggerResults>(iConfig.getParameter<InputTag>("triggerResults"))),
-	triggerPrescales_(consumes<pat::PackedTriggerPrescales>(iConfig.getParameter<InputTag>("triggerPrescales")))
+	triggerResults_(consumes<TriggerResults>(iConfig.getParameter<InputTag>("triggerResults")))
 {
-//	cout << "=================================" << endl;
-//	cout << "FILTER START" << endl;
-//	cout << "=================================" << endl;
-	nevents = 0;
-	nevents_passed = 0;
+	// Compile the selection stages:
+	vector<ParameterSet> stages = iConfig.getParameter<vector<ParameterSet>>("stages");
+	for (unsigned i=0; i < stages.size(); i++) {
+		const ParameterSet& pset = stages[i];
+		Stage stage;
+		string type = pset.getParameter<string>("type");
+		stage.name = pset.existsAs<string>("name") ? pset.getParameter<string>("name") : type + to_string(i);
+		stage.index = i;
+		stage.n = 0;
+		stage.pt = stage.eta = stage.ht = -1;
+		if (type == "trigger") {
+			stage.type = TRIGGER;
+			stage.paths = pset.getParameter<vector<string>>("paths");
+		}
+		else if (type == "jets") {
+			stage.type = JETS;
+			stage.src = consumes<vector<pat::Jet>>(pset.getParameter<InputTag>("src"));
+			stage.n = pset.getParameter<unsigned>("n");
+			stage.pt = pset.getParameter<double>("pt");
+			stage.eta = pset.getParameter<double>("eta");
+		}
+		else if (type == "ht") {
+			stage.type = HT;
+			stage.src = consumes<vector<pat::Jet>>(pset.getParameter<InputTag>("src"));
+			stage.pt = pset.getParameter<double>("pt");
+			stage.ht = pset.getParameter<double>("ht");
+		}
+		else throw cms::Exception("Configuration") << "JetFilter: unknown stage type \"" << type << "\".";
+		// Each stage gets its own "n_<name>" branch, so the names have to be unique:
+		for (vector<Stage>::const_iterator other = stages_.begin(); other != stages_.end(); other++) {
+			if (other->name == stage.name) throw cms::Exception("Configuration") << "JetFilter: there's more than one stage named \"" << stage.name << "\".";
+		}
+		stages_.push_back(stage);
+	}
+	// Cheapest first (a trigger bit, then a few leading jets, then a loop over a whole collection); stages of the same type keep their configured order:
+	sort(stages_.begin(), stages_.end(), [](const Stage& a, const Stage& b) {return a.type != b.type ? a.type < b.type : a.index < b.index;});
+
+	// Per-lumi counts (see the JetFilterSummary):
+	produces<vector<unsigned>, InLumi>("counts");
+	produces<vector<string>, InLumi>("stages");
 }
 
 
 JetFilter::~JetFilter()
 {
- 
+
    // do anything here that needs to be done at desctruction time
    // (e.g. close files, deallocate resources etc.)
 
@@ -107,124 +190,135 @@ JetFilter::~JetFilter()
 // member functions
 //
 
-// ------------ method called on each new Event  ------------
-bool
-JetFilter::filter(edm::Event& iEvent, const edm::EventSetup& iSetup)
-{
-//	cout << "here 97" << endl;
-	nevents ++;
-	
-	// Optional single-muon trigger cut:
+bool JetFilter::pass_trigger(const edm::Event& iEvent, unsigned istage, jetfilter::StreamCache& cache) const {
 	Handle<TriggerResults> results;
 	iEvent.getByToken(triggerResults_, results);
-	Handle<pat::PackedTriggerPrescales> prescales;
-	iEvent.getByToken(triggerPrescales_, prescales);
-	
+	if (!results.isValid()) return false;
+
+	// Only look the paths up again when the trigger menu changes:
 	const TriggerNames& names = iEvent.triggerNames(*results);
-	string trigger_name;
-	for (unsigned int i=0; i < results->size(); ++i) {
-		string full_name = names.triggerName(i);
-		size_t found = full_name.find("HLT_Mu50_v");
-		if (found != string::npos) {		// If contains
-			trigger_name = full_name;
-//			cout << trigger_name << endl;
-			break;
+	if (names.parameterSetID() != cache.trigger_names_id) {
+		cache.trigger_names_id = names.parameterSetID();
+		for (unsigned s=0; s < stages_.size(); s++) {
+			if (stages_[s].type != TRIGGER) continue;
+			cache.indices[s].clear();
+			for (unsigned i=0; i < names.size(); i++) {
+				for (vector<string>::const_iterator path = stages_[s].paths.begin(); path != stages_[s].paths.end(); path++) {
+					if (names.triggerName(i).compare(0, path->size(), *path) == 0) {
+						cache.indices[s].push_back(i);
+						break;
+					}
+				}
+			}
 		}
 	}
-	bool smu_result = results->accept(names.triggerIndex(trigger_name));
-//	cout << trigger_name << "   " << smu_result << endl;
-	
-	if (cut_smu_){
-		if (smu_result) {
-			nevents_passed ++;
-			return true;
-		}
-		else return false;
+
+	const vector<unsigned>& indices = cache.indices[istage];
+	for (vector<unsigned>::const_iterator i = indices.begin(); i != indices.end(); i++) {
+		if (results->accept(*i)) return true;
 	}
-	
-	
-	// Get CA12 jets:
-	Handle<vector<pat::Jet>> jets_edm;
-	iEvent.getByToken(jetCollection_, jets_edm);
-	
-	// Ensure the top two jets have pT greater than cut_pt_:
-//	for (vector<pat::Jet>::const_iterator jet = jets_edm->begin(); jet != jets_edm->end(); ++ jet) {
-//		cout << jet->pt() << endl;
-//	}
-	if (jets_edm.isValid()) {
-//		cout << jets_edm->size() << endl;
-		if (jets_edm->size() >= 2) {
-			pat::Jet jet0 = jets_edm->at(0);
-			pat::Jet jet1 = jets_edm->at(1);
-			if (min(jet0.pt(), jet1.pt()) > cut_pt_ && ((max(abs(jet0.eta()), abs(jet1.eta())) < cut_eta_) || cut_eta_ < 0)) {
-				nevents_passed ++;
-				return true;
-			}
-			else {
-				return false;
-			}
-		}
-		else {
-			return false;
-		}
+	return false;
+}
+
+bool JetFilter::pass_jets(const edm::Event& iEvent, const Stage& stage) const {
+	Handle<vector<pat::Jet>> jets;
+	iEvent.getByToken(stage.src, jets);
+	if (!jets.isValid() || jets->size() < stage.n) return false;
+	for (unsigned i=0; i < stage.n; i++) {
+		const pat::Jet& jet = (*jets)[i];
+		if (jet.pt() <= stage.pt) return false;
+		if (stage.eta >= 0 && fabs(jet.eta()) >= stage.eta) return false;
+	}
+	return true;
+}
+
+bool JetFilter::pass_ht(const edm::Event& iEvent, const Stage& stage) const {
+	Handle<vector<pat::Jet>> jets;
+	iEvent.getByToken(stage.src, jets);
+	if (!jets.isValid()) return false;
+	double ht = 0;
+	for (vector<pat::Jet>::const_iterator jet = jets->begin(); jet != jets->end(); ++jet) {
+		if (jet->pt() > stage.pt) ht += jet->pt();
 	}
-	else {
-		return false;
+	return ht > stage.ht;
+}
+
+// ------------ method called on each new Event  ------------
+bool
+JetFilter::filter(edm::StreamID iStream, edm::Event& iEvent, const edm::EventSetup& iSetup) const
+{
+	jetfilter::StreamCache& cache = *streamCache(iStream);
+	jetfilter::Counts& counts = cache.counts;
+	counts.nevents ++;
+	for (unsigned i=0; i < stages_.size(); i++) {
+		const Stage& stage = stages_[i];
+		bool result = false;
+		if (stage.type == TRIGGER) result = pass_trigger(iEvent, i, cache);
+		else if (stage.type == JETS) result = pass_jets(iEvent, stage);
+		else if (stage.type == HT) result = pass_ht(iEvent, stage);
+		if (!result) return false;
+		counts.nevents_stage[i] ++;
 	}
+	counts.nevents_passed ++;
+	return true;
 }
 
 // ------------ method called once each job just before starting event loop  ------------
-void 
+void
 JetFilter::beginJob() {
-//	cout << "=================================" << endl;
-//	cout << "FILTER BEGIN" << endl;
-//	cout << "=================================" << endl;
 }
 
 // ------------ method called once each job just after ending the event loop  ------------
-void 
+void
 JetFilter::endJob() {
-	cout << "=================================" << endl;
-	cout << "JetFilter information:" << endl;
-	cout << "pT cut = " << cut_pt_ << " GeV" << endl;
-	cout << "abs(eta) cut = " << cut_eta_ << endl;
-	cout << "total events: " << nevents << endl;
-	cout << "accepted events: " << nevents_passed << endl;
-	cout << "=================================" << endl;
 }
 
-// ------------ method called when starting to processes a run  ------------
-/*
+// ------------ method called once each stream before processing any runs, lumis or events  ------------
+unique_ptr<jetfilter::StreamCache>
+JetFilter::beginStream(edm::StreamID) const
+{
+	return make_unique<jetfilter::StreamCache>(stages_.size());
+}
+
+// ------------ methods called when starting to processes a luminosity block  ------------
 void
-JetFilter::beginRun(edm::Run const&, edm::EventSetup const&)
-{ 
+JetFilter::streamBeginLuminosityBlock(edm::StreamID iStream, edm::LuminosityBlock const&, edm::EventSetup const&) const
+{
+	streamCache(iStream)->counts.clear();
+}
+
+shared_ptr<jetfilter::Counts>
+JetFilter::globalBeginLuminosityBlockSummary(edm::LuminosityBlock const&, edm::EventSetup const&) const
+{
+	return make_shared<jetfilter::Counts>(stages_.size());
 }
-*/
- 
-// ------------ method called when ending the processing of a run  ------------
-/*
+
+// ------------ methods called when ending the processing of a luminosity block  ------------
 void
-JetFilter::endRun(edm::Run const&, edm::EventSetup const&)
+JetFilter::streamEndLuminosityBlockSummary(edm::StreamID iStream, edm::LuminosityBlock const&, edm::EventSetup const&, jetfilter::Counts* summary) const
 {
+	// The framework doesn't call this concurrently for the same summary.
+	summary->add(streamCache(iStream)->counts);
 }
-*/
- 
-// ------------ method called when starting to processes a luminosity block  ------------
-/*
+
 void
-JetFilter::beginLuminosityBlock(edm::LuminosityBlock const&, edm::EventSetup const&)
+JetFilter::globalEndLuminosityBlockSummary(edm::LuminosityBlock const&, edm::EventSetup const&, jetfilter::Counts*) const
 {
 }
-*/
- 
-// ------------ method called when ending the processing of a luminosity block  ------------
-/*
+
 void
-JetFilter::endLuminosityBlock(edm::LuminosityBlock const&, edm::EventSetup const&)
+JetFilter::globalEndLuminosityBlockProduce(edm::LuminosityBlock& iLumi, edm::EventSetup const&, jetfilter::Counts const* summary) const
 {
+	auto counts = make_unique<vector<unsigned>>();
+	counts->push_back(summary->nevents);
+	counts->push_back(summary->nevents_passed);
+	counts->insert(counts->end(), summary->nevents_stage.begin(), summary->nevents_stage.end());
+	auto names = make_unique<vector<string>>();
+	for (vector<Stage>::const_iterator stage = stages_.begin(); stage != stages_.end(); stage++) names->push_back(stage->name);
+	iLumi.put(move(counts), "counts");
+	iLumi.put(move(names), "stages");
 }
-*/
- 
+
 // ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
 void
 JetFilter::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
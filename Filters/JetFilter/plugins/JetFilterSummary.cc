@@ -0,0 +1,146 @@
+/*#######################################################
+# CMSSW EDAnalyzer                                      #
+# Name: JetFilterSummary.cc                             #
+# Author: Elliot Hughes                                 #
+#                                                       #
+# Description: Writes the per-lumi counts of a          #
+# JetFilter to a tree.                                  #
+#######################################################*/
+
+
+// system include files
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+// user include files
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/one/EDAnalyzer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/LuminosityBlock.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+/// Custom includes:
+#include "DataFormats/Common/interface/Handle.h"
+#include "FWCore/ServiceRegistry/interface/Service.h"
+#include "CommonTools/UtilAlgos/interface/TFileService.h"
+#include "TTree.h"
+
+
+// NAMESPACES:
+using namespace std;
+using namespace edm;
+// \NAMESPACES
+
+//
+// class declaration
+//
+
+// The JetFilterSummary reads the counts that a JetFilter ("src") puts into each
+// luminosity block and fills a row of the "lumis" tree with "run", "lumi", the
+// number of events ("n"), the number that passed ("n_passed"), and the number
+// that passed each stage and every stage before it ("n_<stage name>"). It's a
+// "one" module that declares the TFileService as a shared resource, so it can
+// run in a multithreaded job next to the (global) JetFilter.
+class JetFilterSummary : public edm::one::EDAnalyzer<edm::one::SharedResources, edm::one::WatchLuminosityBlocks> {
+   public:
+      explicit JetFilterSummary(const edm::ParameterSet&);
+      ~JetFilterSummary();
+
+      static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+   private:
+      virtual void analyze(const edm::Event&, const edm::EventSetup&) override;
+      virtual void beginLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup&) override;
+      virtual void endLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup&) override;
+
+      // ----------member data ---------------------------
+      EDGetTokenT<vector<unsigned>> counts_;
+      EDGetTokenT<vector<string>> stages_;
+      TTree* tree_lumis;
+      /// Branch contents (the stage branches are made at the end of the first lumi, when the stage names are known):
+      unsigned run, lumi;
+      vector<unsigned> counts;
+      vector<string> names;
+};
+
+//
+// constructors and destructor
+//
+JetFilterSummary::JetFilterSummary(const edm::ParameterSet& iConfig)
+{
+	string src = iConfig.getParameter<string>("src");
+	counts_ = consumes<vector<unsigned>, InLumi>(InputTag(src, "counts"));
+	stages_ = consumes<vector<string>, InLumi>(InputTag(src, "stages"));
+
+	usesResource("TFileService");
+	edm::Service<TFileService> fs;
+	tree_lumis = fs->make<TTree>("lumis", "");
+	tree_lumis->Branch("run", &run, "run/i");
+	tree_lumis->Branch("lumi", &lumi, "lumi/i");
+}
+
+
+JetFilterSummary::~JetFilterSummary()
+{
+}
+
+
+//
+// member functions
+//
+
+// ------------ method called for each event  ------------
+void
+JetFilterSummary::analyze(const edm::Event&, const edm::EventSetup&)
+{
+}
+
+// ------------ method called when starting to processes a luminosity block  ------------
+void
+JetFilterSummary::beginLuminosityBlock(edm::LuminosityBlock const&, edm::EventSetup const&)
+{
+}
+
+// ------------ method called when ending the processing of a luminosity block  ------------
+void
+JetFilterSummary::endLuminosityBlock(edm::LuminosityBlock const& iLumi, edm::EventSetup const&)
+{
+	Handle<vector<unsigned>> h_counts;
+	Handle<vector<string>> h_stages;
+	iLumi.getByToken(counts_, h_counts);
+	iLumi.getByToken(stages_, h_stages);
+	if (!h_counts.isValid() || !h_stages.isValid()) return;
+
+	// Book the count branches once ("counts" isn't resized after this, so the branch addresses stay valid):
+	if (names.empty() && counts.empty()) {
+		names = *h_stages;
+		counts.assign(2 + names.size(), 0);
+		tree_lumis->Branch("n", &counts[0], "n/i");
+		tree_lumis->Branch("n_passed", &counts[1], "n_passed/i");
+		for (unsigned i=0; i < names.size(); i++) {
+			string branch_name = "n_" + names[i];
+			tree_lumis->Branch(branch_name.c_str(), &counts[2 + i], (branch_name + "/i").c_str());
+		}
+	}
+	if (h_counts->size() != counts.size()) return;
+
+	run = iLumi.run();
+	lumi = iLumi.luminosityBlock();
+	copy(h_counts->begin(), h_counts->end(), counts.begin());
+	tree_lumis->Fill();
+}
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+JetFilterSummary::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  //The following says we do not know what parameters are allowed so do no validation
+  // Please change this to state exactly what you do use, even if it is no parameters
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+//define this as a plug-in
+DEFINE_FWK_MODULE(JetFilterSummary);
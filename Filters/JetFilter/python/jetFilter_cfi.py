@@ -0,0 +1,47 @@
+import FWCore.ParameterSet.Config as cms
+
+# Selection stages (see "plugins/JetFilter.cc"):
+## Without a "name", the JetFilter names a stage after its type and position in "stages" (like "jets0"), so every name is unique.
+def named(stage, name):
+	if name: stage.name = cms.string(name)
+	return stage
+
+def trigger_stage(paths, name=None):
+	# Passes if any HLT path that starts with one of "paths" fired (so "HLT_Mu50_v" matches every version of HLT_Mu50).
+	return named(cms.PSet(
+		type=cms.string("trigger"),
+		paths=cms.vstring(paths),
+	), name)
+
+def jets_stage(src, pt, eta=-1, n=2, name=None):
+	# Passes if the "n" leading jets of "src" all have pT > "pt" and abs(eta) < "eta" (-1 turns the eta cut off).
+	return named(cms.PSet(
+		type=cms.string("jets"),
+		src=cms.InputTag(src),
+		n=cms.uint32(n),
+		pt=cms.double(pt),
+		eta=cms.double(eta),
+	), name)
+
+def ht_stage(src, ht, pt=30, name=None):
+	# Passes if the pT sum of the jets in "src" with pT > "pt" is greater than "ht".
+	return named(cms.PSet(
+		type=cms.string("ht"),
+		src=cms.InputTag(src),
+		pt=cms.double(pt),
+		ht=cms.double(ht),
+	), name)
+
+JetFilter = cms.EDFilter("JetFilter",
+	stages=cms.VPSet(),
+	triggerResults=cms.InputTag("TriggerResults", "", "HLT"),
+)
+
+JetFilterSummary = cms.EDAnalyzer("JetFilterSummary",
+	src=cms.string("filter"),		# The label of the JetFilter
+)
+
+def add_filter_summary(process, label):
+	# Write the per-lumi counts of the JetFilter called "label" to "<label>Summary/lumis" in the TFileService file:
+	setattr(process, label + "Summary", JetFilterSummary.clone(src=cms.string(label)))
+	setattr(process, label + "SummaryPath", cms.EndPath(getattr(process, label + "Summary")))
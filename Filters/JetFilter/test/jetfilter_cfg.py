@@ -16,6 +16,7 @@ from FWCore.ParameterSet.VarParsing import VarParsing		# Module used to pass arg
 from Configuration.AlCa.autoCond import autoCond		# For automatically determining global tags
 from truculence import *
 from decortication import dataset
+from Filters.JetFilter.jetFilter_cfi import *
 
 # SET UP:
 ## Very basic variables:
@@ -52,7 +53,7 @@ options.register('outFile',
 	"The output file name. This will overwrite the default one assigned by the dataset."
 )
 options.register ('cutPt',
-	175
+	175,
 	VarParsing.multiplicity.singleton,
 	VarParsing.varType.float,
 	"The pT filtering cut. The default is 175 GeV."
@@ -103,10 +104,11 @@ process.TFileService = cms.Service("TFileService",
 )
 # FILTER:
 ## Construct filter:
-process.filter = cms.EDFilter("JetFilter",
-	cut_pt=cms.double(options.cutPt)
+process.filter = JetFilter.clone(
+	stages=cms.VPSet(jets_stage("selectedPatJetsCA12CHS", pt=options.cutPt, eta=2.5)),
 )
 # PATH:
 process.p = cms.Path(
 	process.filter
 )
+add_filter_summary(process, "filter")